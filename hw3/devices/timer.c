@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
@@ -20,12 +21,90 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* TSC when the per-tick work of the latest tick began, and the
+   cycles it took, for the benchmarks in threads/sched-bench.c. */
+static uint64_t last_tick_tsc;
+static uint64_t last_tick_cycles;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* If nonzero, the TSC rate in Hz, which timer_calibrate() then
+   takes instead of measuring it.  timer_calibrate() prints the
+   value to pass.
+   Controlled by kernel command-line option "-o tsc-hz=N". */
+uint64_t timer_tsc_hz_override;
+
+/* Dynamic-tick idle.  If true, the idle thread programs PIT
+   channel 0 one-shot for the next sleeper's wake_tick instead of
+   taking every periodic interrupt.
+   Controlled by kernel command-line option "-o tickless". */
+bool timer_tickless;
+
+/* 8254 ports and input frequency, as in devices/pit.c. */
+#define PIT_PORT_CONTROL 0x43
+#define PIT_PORT_COUNTER0 0x40
+#define PIT_PORT_COUNTER2 0x42
+#define PIT_HZ 1193180
+
+/* Keyboard controller port B: bit 0 gates PIT channel 2, bit 1
+   enables the speaker, bit 5 reads channel 2's OUT. */
+#define PORT_B 0x61
+
+/* TSC calibration runs channel 2 one-shot for this long, short of
+   a tick so that no timer interrupt is lost meanwhile. */
+#define CALIBRATE_MS 5
+#define CALIBRATE_LOOPS (1u << 16)
+
+/* PIT counts per timer tick, rounded as pit_configure_channel()
+   does, and the most ticks a 16-bit one-shot count can cover. */
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define TICKLESS_MAX_TICKS (0xffff / PIT_TICK_COUNT)
+
+/* One-shot state, valid while oneshot_armed is true. */
+static bool oneshot_armed;      /* Channel 0 is in one-shot mode. */
+static int64_t oneshot_ticks;   /* Ticks to account when it fires. */
+static unsigned oneshot_count;  /* Count it was programmed with. */
+static unsigned oneshot_offset; /* Counts of the first tick already
+                                   elapsed when it was programmed. */
+
+/* TSC clock source, set up by timer_calibrate().  timer_ns() is
+   tsc_base_ns plus the TSC cycles since tsc_base, converted at
+   tsc_hz; until then it counts whole ticks. */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static int64_t tsc_base_ns;
+
+/* Pending hrtimers, earliest expiry first.  They are expired on
+   every timer interrupt.  One due before the next tick boundary
+   gets an interrupt of its own: channel 0 is switched to a
+   one-shot for it, and when that fires (hr_armed), to another
+   one-shot for the remaining hr_rest counts up to the boundary,
+   after which it goes periodic again as for tickless idle. */
+static struct heap hrtimer_queue;
+static bool hr_armed;           /* Channel 0 one-shot is for an hrtimer. */
+static unsigned hr_rest;        /* Counts from it to the tick boundary. */
+
+/* Shortest one-shot worth programming, and the matching slack
+   within which an hrtimer counts as due. */
+#define HR_MIN_COUNT 16
+#define HR_SLACK_NS (HR_MIN_COUNT * NS_PER_SEC / PIT_HZ)
+
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
+static void timer_advance (int64_t elapsed);
+static void pit_oneshot (int64_t ticks, unsigned left);
+static unsigned pit_read_count (uint8_t *status);
+static bool pic_timer_pending (void);
+static bool hrtimer_less (const struct heap_elem *, const struct heap_elem *,
+                          void *aux);
+static void hrtimer_expire (void);
+static void hrtimer_arm (void);
+static void hrtimer_resume_tick (void);
+static int64_t hrtimer_ticks_until (int64_t limit);
+static void hrsleep_wakeup (struct hrtimer *, void *thread);
+static void hrsleep (int64_t ns);
+static uint64_t pit_measure_tsc (void);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
@@ -36,34 +115,42 @@ void
 timer_init (void) 
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  heap_init (&hrtimer_queue, hrtimer_less, NULL);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the TSC clock source and loops_per_tick, used to
+   implement brief delays.
+
+   The TSC rate is measured once against a short PIT channel 2
+   one-shot, or taken from "-o tsc-hz=", and loops_per_tick is
+   then derived by timing a fixed busy-wait on the TSC, so no
+   timer ticks need to pass. */
 void
 timer_calibrate (void) 
 {
-  unsigned high_bit, test_bit;
+  enum intr_level old_level;
+  uint64_t start_tsc, cycles;
 
-  ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
 
-  /* Approximate loops_per_tick as the largest power-of-two
-     still less than one timer tick. */
-  loops_per_tick = 1u << 10;
-  while (!too_many_loops (loops_per_tick << 1)) 
-    {
-      loops_per_tick <<= 1;
-      ASSERT (loops_per_tick != 0);
-    }
+  old_level = intr_disable ();
+  tsc_hz = timer_tsc_hz_override;
+  if (tsc_hz == 0)
+    tsc_hz = pit_measure_tsc ();
+
+  start_tsc = rdtsc ();
+  busy_wait (CALIBRATE_LOOPS);
+  cycles = rdtsc () - start_tsc;
+  loops_per_tick = (uint64_t) CALIBRATE_LOOPS * (tsc_hz / TIMER_FREQ) / cycles;
+  ASSERT (loops_per_tick != 0);
 
-  /* Refine the next 8 bits of loops_per_tick. */
-  high_bit = loops_per_tick;
-  for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-    if (!too_many_loops (high_bit | test_bit))
-      loops_per_tick |= test_bit;
+  tsc_base = rdtsc ();
+  tsc_base_ns = ticks * NS_PER_TICK;
+  intr_set_level (old_level);
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" loops/s, TSC %'"PRIu64" Hz (-o tsc-hz=%"PRIu64").\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, tsc_hz, tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -84,6 +171,84 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted. */
+int64_t
+timer_ns (void)
+{
+  enum intr_level old_level;
+  uint64_t cycles;
+  int64_t ns;
+
+  if (tsc_hz == 0)
+    return timer_ticks () * NS_PER_TICK;
+
+  old_level = intr_disable ();
+  cycles = rdtsc () - tsc_base;
+  ns = tsc_base_ns + (int64_t) (cycles / tsc_hz) * NS_PER_SEC
+       + (int64_t) (cycles % tsc_hz * NS_PER_SEC / tsc_hz);
+  intr_set_level (old_level);
+  return ns;
+}
+
+/* Returns the TSC rate in Hz, or 0 before timer_calibrate(). */
+uint64_t
+timer_tsc_hz (void)
+{
+  return tsc_hz;
+}
+
+/* Initializes TIMER to call FUNC, passing AUX, when it expires. */
+void
+hrtimer_init (struct hrtimer *timer, hrtimer_func *func, void *aux)
+{
+  ASSERT (timer != NULL);
+  ASSERT (func != NULL);
+
+  timer->func = func;
+  timer->aux = aux;
+  timer->armed = false;
+}
+
+/* Arms TIMER, which must not be armed already, to expire at
+   EXPIRES nanoseconds in timer_ns() time.  TIMER's function runs
+   in the timer interrupt handler, so it must not sleep.  An
+   expiry within the current tick is precise only if no earlier
+   hrtimer has claimed the tick's one-shot already. */
+void
+hrtimer_start (struct hrtimer *timer, int64_t expires)
+{
+  enum intr_level old_level;
+
+  ASSERT (!timer->armed);
+
+  old_level = intr_disable ();
+  timer->expires = expires;
+  timer->armed = true;
+  heap_insert (&hrtimer_queue, &timer->elem);
+  if (heap_min (&hrtimer_queue) == &timer->elem)
+    hrtimer_arm ();
+  intr_set_level (old_level);
+}
+
+/* Disarms TIMER.  Returns true if it was armed, false if it had
+   expired or was never started. */
+bool
+hrtimer_cancel (struct hrtimer *timer)
+{
+  enum intr_level old_level;
+  bool was_armed;
+
+  old_level = intr_disable ();
+  was_armed = timer->armed;
+  if (was_armed)
+    {
+      heap_remove (&hrtimer_queue, &timer->elem);
+      timer->armed = false;
+    }
+  intr_set_level (old_level);
+  return was_armed;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -97,6 +262,30 @@ timer_sleep (int64_t ticks)
   thread_yield_sleep(end); // Thread will sleep til end
 }
 
+/* Checks that a sleep already due when it is armed wakes on the
+   next tick instead of a full turn of the sleep wheel later:
+   timer_sleep(0), and a one-tick sleep whose tick passes between
+   reading timer_ticks() and arming it. */
+void
+timer_sleep_self_test (void)
+{
+  int64_t start;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  printf ("Testing timer_sleep()...");
+  start = timer_ticks ();
+  timer_sleep (0);
+  ASSERT (timer_elapsed (start) <= 2);
+
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  thread_yield_sleep (start + 1);       /* Already due, as in the race. */
+  ASSERT (timer_elapsed (start) <= 3);
+  printf ("done.\n");
+}
+
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
    turned on. */
 void
@@ -160,6 +349,32 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Returns the TSC cycles that the per-tick work of the latest
+   timer tick took: waking sleepers, the MLFQS updates and
+   thread_tick(). */
+uint64_t
+timer_last_tick_cycles (void)
+{
+  enum intr_level old_level = intr_disable ();
+  uint64_t cycles = last_tick_cycles;
+  intr_set_level (old_level);
+  return cycles;
+}
+
+/* Returns the number of timer ticks since the OS booted, like
+   timer_ticks(), and stores in *TSC the TSC at which the latest
+   of them was counted.  After tickless idle, several ticks are
+   counted at once, so that is then later than the tick began. */
+int64_t
+timer_ticks_tsc (uint64_t *tsc)
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t t = ticks;
+  *tsc = last_tick_tsc;
+  intr_set_level (old_level);
+  return t;
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
@@ -167,32 +382,188 @@ timer_print_stats (void)
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, replaces the periodic interrupt by a
+   single one at the earliest tick the sleep queue needs,
+   keeping the phase of the tick boundaries. */
+void
+timer_idle_enter (void)
+{
+  int64_t idle_ticks;
+  unsigned left;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_armed || hr_armed)
+    return;
+
+  idle_ticks = hrtimer_ticks_until (ticks_until_wake (TICKLESS_MAX_TICKS));
+  if (idle_ticks < 2)
+    return;
+
+  /* A periodic interrupt that is already pending, or that could
+     arrive while we reprogram, would be taken for the one-shot. */
+  left = pit_read_count (NULL);
+  if (left < PIT_TICK_COUNT / 16 || pic_timer_pending ())
+    return;
+  pit_oneshot (idle_ticks, left);
+}
+
+/* Called with interrupts off when the idle thread stops idling:
+   by the idle thread when it wakes up from its halt, and by
+   yield_to_max() when an interrupt handler is about to switch
+   away from it.  If something other than the one-shot woke us,
+   accounts the whole ticks that passed and arranges for the
+   periodic interrupt to resume at the next tick boundary, so the
+   thread that runs next gets ordinary ticks and is not charged
+   for the idle time. */
+void
+timer_idle_exit (void)
+{
+  uint8_t status;
+  unsigned elapsed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!oneshot_armed || oneshot_ticks == 1 || hr_armed)
+    return;
+
+  elapsed = oneshot_count - pit_read_count (&status) + oneshot_offset;
+  if (status & 0x80)
+    {
+      /* OUT is high: the one-shot already expired and its
+         interrupt is still pending.  Account all but its last
+         tick now and go periodic, so that the pending interrupt
+         counts as one ordinary tick. */
+      oneshot_armed = false;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      timer_advance (oneshot_ticks - 1);
+      return;
+    }
+
+  pit_oneshot (1, PIT_TICK_COUNT - elapsed % PIT_TICK_COUNT);
+  timer_advance (elapsed / PIT_TICK_COUNT);
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;  
-  wake_blocked_thread(timer_ticks()); // Awake the blocked thread
-  thread_tick ();
+  int64_t elapsed = 1;
+
+  if (hr_armed)
+    {
+      /* An hrtimer's one-shot, between tick boundaries. */
+      hr_armed = false;
+      hrtimer_expire ();
+      hrtimer_resume_tick ();
+      hrtimer_arm ();
+      return;
+    }
+  if (oneshot_armed)
+    {
+      /* Back from tickless idle: catch up and go periodic. */
+      elapsed = oneshot_ticks;
+      oneshot_armed = false;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+  timer_advance (elapsed);
+  hrtimer_expire ();
+  hrtimer_arm ();
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops) 
+/* Does the per-tick work for ELAPSED ticks, one tick at a time,
+   so that ticks, the sleep queue and thread_tick() statistics
+   come out the same as with one interrupt per tick. */
+static void
+timer_advance (int64_t elapsed)
 {
-  /* Wait for a timer tick. */
-  int64_t start = ticks;
-  while (ticks == start)
-    barrier ();
+  while (elapsed-- > 0)
+    {
+      uint64_t start = rdtsc ();
+
+      ticks++;
+      wake_blocked_thread (ticks); // Awake the blocked thread
+
+      if (thread_mlfqs) {
+        /* ticks가 증가할때마다 current thread의 recent cpu값을 1씩 증가시켜줌 (manual) */
+        recent_cpu_increase();
+        /* 1 second마다 load_avg와 recent_cpu를 update해야함. blocked thread는 깨어날 때 따라잡음 */
+        if (ticks % TIMER_FREQ == 0)
+          refresh_all_load_avg_recent_cpu_priority(BOOL_REFRESH_PRIORITY);
+        if (ticks % 4 == 0) // 4 clock tick 마다 priority 재 계산
+          set_priority();
+      }
+      thread_tick ();
+      last_tick_tsc = start;
+      last_tick_cycles = rdtsc () - start;
+    }
+}
 
-  /* Run LOOPS loops. */
-  start = ticks;
-  busy_wait (loops);
+/* Programs PIT channel 0 to interrupt once, TICKS tick
+   boundaries from now, given that the next boundary is LEFT
+   counts away.  See [8254] for the mode 0 programming sequence. */
+static void
+pit_oneshot (int64_t ticks, unsigned left)
+{
+  unsigned count = left + (ticks - 1) * PIT_TICK_COUNT;
 
-  /* If the tick count changed, we iterated too long. */
-  barrier ();
-  return start != ticks;
+  ASSERT (ticks >= 1 && ticks <= TICKLESS_MAX_TICKS);
+  ASSERT (count >= 1 && count <= 0xffff);
+
+  outb (PIT_PORT_CONTROL, 0x30);        /* Counter 0, LSB then MSB, mode 0. */
+  outb (PIT_PORT_COUNTER0, count);
+  outb (PIT_PORT_COUNTER0, count >> 8);
+
+  oneshot_armed = true;
+  oneshot_ticks = ticks;
+  oneshot_count = count;
+  oneshot_offset = PIT_TICK_COUNT - left;
+}
+
+/* Returns the current count of PIT channel 0, and its status
+   byte in *STATUS if STATUS is nonnull, using the read-back
+   command. */
+static unsigned
+pit_read_count (uint8_t *status)
+{
+  uint8_t st, lo, hi;
+
+  outb (PIT_PORT_CONTROL, 0xc2);        /* Read-back status and count of counter 0. */
+  st = inb (PIT_PORT_COUNTER0);
+  lo = inb (PIT_PORT_COUNTER0);
+  hi = inb (PIT_PORT_COUNTER0);
+  if (status != NULL)
+    *status = st;
+  return lo | (hi << 8);
+}
+
+/* Returns the TSC rate in Hz, measured over a CALIBRATE_MS
+   one-shot of PIT channel 2 with interrupts off.  See [8254]. */
+static uint64_t
+pit_measure_tsc (void)
+{
+  unsigned count = PIT_HZ * CALIBRATE_MS / 1000;
+  uint64_t start, end;
+  uint8_t port_b;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Gate channel 2 on, speaker off, and start it counting. */
+  port_b = inb (PORT_B);
+  outb (PORT_B, (port_b & ~0x02) | 0x01);
+  outb (PIT_PORT_CONTROL, 0xb0);        /* Counter 2, LSB then MSB, mode 0. */
+  outb (PIT_PORT_COUNTER2, count);
+  outb (PIT_PORT_COUNTER2, count >> 8);
+  start = rdtsc ();
+
+  /* OUT goes high at terminal count. */
+  while ((inb (PORT_B) & 0x20) == 0)
+    continue;
+  end = rdtsc ();
+  outb (PORT_B, port_b);
+
+  return (end - start) * 1000 / CALIBRATE_MS;
 }
 
 /* Iterates through a simple loop LOOPS times, for implementing
@@ -229,6 +600,11 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */                
       timer_sleep (ticks); 
     }
+  else if (tsc_hz != 0)
+    {
+      /* Block on an hrtimer, which wakes us between ticks. */
+      hrsleep (num * (NS_PER_SEC / denom));
+    }
   else 
     {
       /* Otherwise, use a busy-wait loop for more accurate
@@ -237,6 +613,31 @@ real_time_sleep (int64_t num, int32_t denom)
     }
 }
 
+/* Blocks the current thread for NS nanoseconds, on an hrtimer. */
+static void
+hrsleep (int64_t ns)
+{
+  struct hrtimer timer;
+  enum intr_level old_level;
+
+  hrtimer_init (&timer, hrsleep_wakeup, thread_current ());
+  old_level = intr_disable ();
+  hrtimer_start (&timer, timer_ns () + ns);
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* hrtimer function for hrsleep(): wakes THREAD, and runs it
+   right away if it outranks the interrupted thread. */
+static void
+hrsleep_wakeup (struct hrtimer *timer UNUSED, void *thread)
+{
+  struct thread *t = thread;
+
+  thread_unblock (t);
+  yield_to_max ();
+}
+
 /* Busy-wait for approximately NUM/DENOM seconds. */
 static void
 real_time_delay (int64_t num, int32_t denom)
@@ -246,3 +647,114 @@ real_time_delay (int64_t num, int32_t denom)
   ASSERT (denom % 1000 == 0);
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
+
+/* Returns true if the master PIC has a timer interrupt (IRQ 0)
+   requested but not yet delivered. */
+static bool
+pic_timer_pending (void)
+{
+  outb (0x20, 0x0a);                    /* OCW3: read IRR. */
+  return (inb (0x20) & 1) != 0;
+}
+
+/* Orders hrtimer_queue by expiry time. */
+static bool
+hrtimer_less (const struct heap_elem *a_, const struct heap_elem *b_,
+              void *aux UNUSED)
+{
+  const struct hrtimer *a = heap_entry (a_, struct hrtimer, elem);
+  const struct hrtimer *b = heap_entry (b_, struct hrtimer, elem);
+
+  return a->expires < b->expires;
+}
+
+/* Runs the functions of all hrtimers that are due. */
+static void
+hrtimer_expire (void)
+{
+  int64_t now = timer_ns ();
+
+  ASSERT (intr_context ());
+
+  while (!heap_empty (&hrtimer_queue))
+    {
+      struct hrtimer *timer = heap_entry (heap_min (&hrtimer_queue),
+                                          struct hrtimer, elem);
+      if (timer->expires > now + HR_SLACK_NS)
+        break;
+      heap_pop_min (&hrtimer_queue);
+      timer->armed = false;
+      timer->func (timer, timer->aux);
+    }
+}
+
+/* If the earliest hrtimer is due before the next tick boundary,
+   switches channel 0 to a one-shot for it.  Does nothing while a
+   multi-tick tickless one-shot is armed, since timer_idle_enter()
+   makes that one end in the tick the hrtimer falls in. */
+static void
+hrtimer_arm (void)
+{
+  const struct hrtimer *timer;
+  int64_t delta_ns;
+  unsigned left, count;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (tsc_hz == 0 || hr_armed || heap_empty (&hrtimer_queue)
+      || (oneshot_armed && oneshot_ticks > 1))
+    return;
+
+  timer = heap_entry (heap_min (&hrtimer_queue), struct hrtimer, elem);
+  delta_ns = timer->expires - timer_ns ();
+  if (delta_ns >= NS_PER_TICK)
+    return;
+  left = pit_read_count (NULL);
+  count = delta_ns > 0 ? delta_ns * PIT_HZ / NS_PER_SEC : 0;
+  if (count < HR_MIN_COUNT)
+    count = HR_MIN_COUNT;
+  if (count + HR_MIN_COUNT >= left)
+    return;
+
+  outb (PIT_PORT_CONTROL, 0x30);        /* Counter 0, LSB then MSB, mode 0. */
+  outb (PIT_PORT_COUNTER0, count);
+  outb (PIT_PORT_COUNTER0, count >> 8);
+  hr_armed = true;
+  hr_rest = left - count;
+  oneshot_armed = false;
+}
+
+/* Called when an hrtimer's one-shot has fired: programs a
+   one-shot for the rest of the tick, or, if the tick boundary has
+   already come, accounts the tick and goes periodic again.  In
+   mode 0 the counter keeps counting down past zero, which tells
+   how long ago the one-shot fired. */
+static void
+hrtimer_resume_tick (void)
+{
+  unsigned since = (0x10000 - pit_read_count (NULL)) & 0xffff;
+
+  if (since + HR_MIN_COUNT < hr_rest)
+    pit_oneshot (1, hr_rest - since);
+  else
+    {
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      timer_advance (1);
+      hrtimer_expire ();
+    }
+}
+
+/* Returns LIMIT, or the number of whole ticks until the earliest
+   hrtimer if that is less. */
+static int64_t
+hrtimer_ticks_until (int64_t limit)
+{
+  const struct hrtimer *timer;
+  int64_t delta;
+
+  if (heap_empty (&hrtimer_queue))
+    return limit;
+  timer = heap_entry (heap_min (&hrtimer_queue), struct hrtimer, elem);
+  delta = (timer->expires - timer_ns ()) / NS_PER_TICK;
+  return delta < limit ? delta : limit;
+}
@@ -2,28 +2,75 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include "threads/heap.h"
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Nanoseconds per second and per timer tick. */
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+
 void timer_init (void);
 void timer_calibrate (void);
+extern uint64_t timer_tsc_hz_override;
+
+/* Tickless idle. */
+extern bool timer_tickless;
+void timer_idle_enter (void);
+void timer_idle_exit (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+/* High-resolution clock: nanoseconds since boot, from the TSC
+   once timer_calibrate() has measured its rate. */
+int64_t timer_ns (void);
+uint64_t timer_tsc_hz (void);
+
+/* Returns the current value of the time stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* High-resolution timer.  Calls FUNC, passing the timer and AUX,
+   from the timer interrupt handler at the first opportunity
+   after timer_ns() reaches EXPIRES. */
+struct hrtimer;
+typedef void hrtimer_func (struct hrtimer *, void *aux);
+struct hrtimer
+  {
+    int64_t expires;            /* Deadline, in timer_ns() time. */
+    hrtimer_func *func;         /* Function to call. */
+    void *aux;                  /* Auxiliary data for func. */
+    bool armed;                 /* Waiting to expire? */
+    struct heap_elem elem;      /* Element in the hrtimer queue. */
+  };
+
+void hrtimer_init (struct hrtimer *, hrtimer_func *, void *aux);
+void hrtimer_start (struct hrtimer *, int64_t expires);
+bool hrtimer_cancel (struct hrtimer *);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks); 
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
+void timer_sleep_self_test (void);
 
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+uint64_t timer_last_tick_cycles (void);
+int64_t timer_ticks_tsc (uint64_t *tsc);
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -0,0 +1,168 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Fixed-point arithmetic for the MLFQS scheduler (HW2).
+
+   A fixed_t is a distinct type, so it cannot be mixed up with a
+   plain int by accident.  The Q format is chosen at build time:
+   17.14 in an int32_t by default, or 32.32 in an int64_t if
+   FIXED_POINT_Q32_32 is defined (add -DFIXED_POINT_Q32_32 to
+   CPPFLAGS).
+
+   Every operation rounds exactly like the old int helpers, that
+   is, divisions truncate toward zero.  Where the divisor is the
+   fixed-point scale, a shift of the magnitude takes the place of
+   the division. */
+
+#ifdef FIXED_POINT_Q32_32
+typedef int64_t fixed_raw_t;
+typedef uint64_t fixed_uraw_t;
+#define FIXED_POINT_SHIFT 32
+#else
+typedef int32_t fixed_raw_t;
+typedef uint32_t fixed_uraw_t;
+#define FIXED_POINT_SHIFT 14
+#endif
+
+/* 1.0 in fixed point. */
+#define FIXED_POINT_MASK ((fixed_raw_t) 1 << FIXED_POINT_SHIFT)
+
+typedef struct
+  {
+    fixed_raw_t raw;            /* Value times FIXED_POINT_MASK. */
+  }
+fixed_t;
+
+static inline fixed_t
+fixed_from_raw (fixed_raw_t raw)
+{
+  fixed_t x;
+  x.raw = raw;
+  return x;
+}
+
+static inline fixed_t
+convert_to_fixed_point (int n)
+{
+  return fixed_from_raw ((fixed_raw_t) n * FIXED_POINT_MASK);
+}
+
+static inline int
+convert_to_int_to_zero (fixed_t x)
+{
+  if (x.raw >= 0)
+    return x.raw >> FIXED_POINT_SHIFT;
+  else
+    return -(-x.raw >> FIXED_POINT_SHIFT);
+}
+
+static inline int
+convert_to_int_to_nearest (fixed_t x)
+{
+  if (x.raw >= 0)
+    return (x.raw + FIXED_POINT_MASK / 2) >> FIXED_POINT_SHIFT;
+  else
+    return -((-x.raw + FIXED_POINT_MASK / 2) >> FIXED_POINT_SHIFT);
+}
+
+static inline fixed_t
+add_fixed_and_fixed (fixed_t x, fixed_t y)
+{
+  return fixed_from_raw (x.raw + y.raw);
+}
+
+static inline fixed_t
+add_fixed_and_int (fixed_t x, int n)
+{
+  return fixed_from_raw (x.raw + (fixed_raw_t) n * FIXED_POINT_MASK);
+}
+
+static inline fixed_t
+substract_fixed_and_fixed (fixed_t x, fixed_t y)
+{
+  return fixed_from_raw (x.raw - y.raw);
+}
+
+static inline fixed_t
+substract_fixed_and_int (fixed_t x, int n)
+{
+  return fixed_from_raw (x.raw - (fixed_raw_t) n * FIXED_POINT_MASK);
+}
+
+static inline fixed_t
+multiply_fixed_and_int (fixed_t x, int n)
+{
+  return fixed_from_raw (x.raw * n);
+}
+
+static inline fixed_t
+divide_fixed_and_int (fixed_t x, int n)
+{
+  return fixed_from_raw (x.raw / n);
+}
+
+#ifdef FIXED_POINT_Q32_32
+/* Returns A * B / 2**32 for unsigned A and B, truncated, from
+   32x32-bit partial products, since there is no 128-bit type. */
+static inline uint64_t
+fixed_umul_shift (uint64_t a, uint64_t b)
+{
+  uint64_t a_hi = a >> 32, a_lo = (uint32_t) a;
+  uint64_t b_hi = b >> 32, b_lo = (uint32_t) b;
+
+  return ((a_hi * b_hi) << 32) + a_hi * b_lo + a_lo * b_hi
+         + ((a_lo * b_lo) >> 32);
+}
+
+/* Returns A * 2**32 / B for unsigned A and B, truncated, by
+   long division of the 96-bit dividend one bit at a time. */
+static inline uint64_t
+fixed_udiv_shift (uint64_t a, uint64_t b)
+{
+  uint64_t q = a / b;
+  uint64_t r = a % b;
+  int i;
+
+  for (i = 0; i < 32; i++)
+    {
+      r <<= 1;
+      q <<= 1;
+      if (r >= b)
+        {
+          r -= b;
+          q |= 1;
+        }
+    }
+  return q;
+}
+#endif
+
+static inline fixed_t
+multiply_fixed_and_fixed (fixed_t x, fixed_t y)
+{
+#ifdef FIXED_POINT_Q32_32
+  uint64_t p = fixed_umul_shift (x.raw >= 0 ? x.raw : -x.raw,
+                                 y.raw >= 0 ? y.raw : -y.raw);
+  return fixed_from_raw ((x.raw < 0) != (y.raw < 0) ? -(int64_t) p : (int64_t) p);
+#else
+  int64_t p = (int64_t) x.raw * y.raw;
+  return fixed_from_raw (p >= 0 ? p >> FIXED_POINT_SHIFT
+                                : -(-p >> FIXED_POINT_SHIFT));
+#endif
+}
+
+static inline fixed_t
+divide_fixed_and_fixed (fixed_t x, fixed_t y)
+{
+#ifdef FIXED_POINT_Q32_32
+  uint64_t q = fixed_udiv_shift (x.raw >= 0 ? x.raw : -x.raw,
+                                 y.raw >= 0 ? y.raw : -y.raw);
+  return fixed_from_raw ((x.raw < 0) != (y.raw < 0) ? -(int64_t) q : (int64_t) q);
+#else
+  return fixed_from_raw ((int64_t) x.raw * FIXED_POINT_MASK / y.raw);
+#endif
+}
+
+#endif /* threads/fixed_point.h */
@@ -0,0 +1,182 @@
+#include "threads/heap.h"
+#include <debug.h>
+
+/* A pairing heap is a heap-ordered multiway tree.  Each node
+   keeps its children in a doubly linked sibling list, so that
+   any node can be cut out of the tree in O(1); the cost of
+   restoring a single tree is paid by the two-pass pairing in
+   merge_pairs(). */
+
+static struct heap_elem *meld (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux)
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->size = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_insert (struct heap *heap, struct heap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->sibling = elem->prev = NULL;
+  heap->root = meld (heap, heap->root, elem);
+  heap->size++;
+}
+
+/* Returns the minimum element of HEAP, without removing it, or
+   a null pointer if HEAP is empty. */
+struct heap_elem *
+heap_min (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->root;
+}
+
+/* Removes and returns the minimum element of HEAP, which must
+   not be empty. */
+struct heap_elem *
+heap_pop_min (struct heap *heap)
+{
+  struct heap_elem *min;
+
+  ASSERT (heap != NULL);
+  ASSERT (!heap_empty (heap));
+
+  min = heap->root;
+  heap->root = merge_pairs (heap, min->child);
+  heap->size--;
+  min->child = NULL;
+  return min;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem == heap->root)
+    {
+      heap_pop_min (heap);
+      return;
+    }
+
+  /* Cut ELEM's subtree out of its parent's child list, then
+     merge ELEM's children back in at the root. */
+  ASSERT (elem->prev != NULL);
+  if (elem->prev->child == elem)
+    elem->prev->child = elem->sibling;
+  else
+    elem->prev->sibling = elem->sibling;
+  if (elem->sibling != NULL)
+    elem->sibling->prev = elem->prev;
+
+  heap->root = meld (heap, heap->root, merge_pairs (heap, elem->child));
+  heap->size--;
+  elem->child = elem->sibling = elem->prev = NULL;
+}
+
+/* Restores HEAP's ordering after the key of ELEM, which must be
+   in HEAP, has changed. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem)
+{
+  heap_remove (heap, elem);
+  heap_insert (heap, elem);
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->root == NULL;
+}
+
+/* Links the trees rooted at A and B, either of which may be
+   null, and returns the root of the result. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b)
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (heap->less (b, a, heap->aux))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  /* B becomes A's first child. */
+  b->sibling = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  b->prev = a;
+  a->child = b;
+  a->sibling = a->prev = NULL;
+  return a;
+}
+
+/* Combines the sibling list starting at FIRST into a single
+   tree and returns its root: first meld the siblings in pairs
+   from left to right, then meld the pairs from right to left. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root = NULL;
+
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->sibling;
+      struct heap_elem *pair;
+
+      first = b != NULL ? b->sibling : NULL;
+      a->sibling = a->prev = NULL;
+      if (b != NULL)
+        b->sibling = b->prev = NULL;
+
+      pair = meld (heap, a, b);
+      pair->sibling = pairs;
+      pairs = pair;
+    }
+
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->sibling;
+
+      pairs->sibling = NULL;
+      root = meld (heap, pairs, root);
+      pairs = next;
+    }
+  return root;
+}
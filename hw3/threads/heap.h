@@ -0,0 +1,65 @@
+#ifndef THREADS_HEAP_H
+#define THREADS_HEAP_H
+
+/* Intrusive pairing heap.
+
+   Like struct list, a heap stores elements embedded in the
+   structures being ordered: put a `struct heap_elem' member in
+   the structure and use heap_entry() to get back from the
+   element to the structure.  The element the heap's
+   heap_less_func orders first is the "minimum".
+
+   Insertion and finding the minimum are O(1); removing the
+   minimum, or any other element, is O(log n) amortized.  To
+   change an element's key, remove it, change it, and insert it
+   again, or use heap_update().
+
+   A heap does no locking of its own. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem
+  {
+    struct heap_elem *child;    /* First child. */
+    struct heap_elem *sibling;  /* Next sibling. */
+    struct heap_elem *prev;     /* Parent if first child, otherwise
+                                   previous sibling; NULL for root. */
+  };
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+                     - offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A should come out of the
+   heap before B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap
+  {
+    struct heap_elem *root;     /* Minimum element. */
+    size_t size;                /* Number of elements. */
+    heap_less_func *less;       /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_min (const struct heap *);
+struct heap_elem *heap_pop_min (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* threads/heap.h */
@@ -0,0 +1,858 @@
+#include "threads/sched-bench.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Scheduler and synchronization benchmarks, timed with the TSC.
+
+   sched_bench_run() prints one line per benchmark and setting,
+
+     BENCH <name> [<param>=<value>...] n=<samples> min=<c> avg=<c> max=<c>
+
+   where min, avg and max are in TSC cycles per sample, between a
+   "BENCH-BEGIN <tsc-hz>" and a "BENCH-END" line, so a script can
+   pick the results out of the console output and compare them
+   across builds. */
+
+bool sched_bench_enabled;
+
+#define BENCH_ITERS 1000                /* Samples per benchmark. */
+#define BENCH_ROUNDS 50                 /* Rounds of the multi-thread ones. */
+
+/* Cycle counts of one benchmark. */
+struct bench_stats
+  {
+    unsigned n;                 /* # of samples. */
+    int64_t min;                /* Smallest sample. */
+    int64_t max;                /* Largest sample. */
+    int64_t sum;                /* Sum of samples. */
+  };
+
+static void
+stats_init (struct bench_stats *s)
+{
+  s->n = 0;
+  s->min = INT64_MAX;
+  s->max = INT64_MIN;
+  s->sum = 0;
+}
+
+/* Adds a sample of CYCLES to S.  May be called by several
+   threads at once. */
+static void
+stats_add (struct bench_stats *s, int64_t cycles)
+{
+  enum intr_level old_level = intr_disable ();
+  s->n++;
+  if (cycles < s->min)
+    s->min = cycles;
+  if (cycles > s->max)
+    s->max = cycles;
+  s->sum += cycles;
+  intr_set_level (old_level);
+}
+
+/* Prints S as the result of benchmark NAME run with PARAMS, a
+   possibly empty list of "<param>=<value>" words. */
+static void
+stats_print (const char *name, const char *params,
+             const struct bench_stats *s)
+{
+  if (s->n == 0)
+    {
+      printf ("BENCH %s%s%s n=0\n", name, *params ? " " : "", params);
+      return;
+    }
+  printf ("BENCH %s%s%s n=%u min=%"PRId64" avg=%"PRId64" max=%"PRId64"\n",
+          name, *params ? " " : "", params,
+          s->n, s->min, s->sum / s->n, s->max);
+}
+
+/* Starts a helper thread for a benchmark.  A benchmark cannot go
+   on without its helpers, so failing to create one is fatal. */
+static void
+bench_spawn (const char *name, int priority, thread_func *func, void *aux)
+{
+  if (thread_create (name, priority, func, aux) == TID_ERROR)
+    PANIC ("sched bench: cannot create thread \"%s\"", name);
+}
+
+/* Returns the priority STEP levels above BASE, at most PRI_MAX.
+   Donation raises the main thread's priority as a benchmark goes
+   on, so BASE has to be read before it starts. */
+static int
+bench_priority (int base, int step)
+{
+  return base + step < PRI_MAX ? base + step : PRI_MAX;
+}
+
+/* Semaphore ping-pong.  Two threads of equal priority hand the
+   CPU back and forth through a pair of semaphores; each sample
+   is one round trip, that is, two context switches. */
+struct pingpong
+  {
+    struct semaphore ping;      /* Main thread -> helper. */
+    struct semaphore pong;      /* Helper -> main thread. */
+    struct semaphore exited;    /* Helper is done. */
+  };
+
+static void
+pingpong_thread (void *pp_)
+{
+  struct pingpong *pp = pp_;
+  int i;
+
+  for (i = 0; i < BENCH_ITERS; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+  sema_up (&pp->exited);
+}
+
+static void
+bench_sema_pingpong (void)
+{
+  struct pingpong pp;
+  struct bench_stats s;
+  int i;
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  sema_init (&pp.exited, 0);
+  stats_init (&s);
+  bench_spawn ("pingpong", thread_get_priority (), pingpong_thread, &pp);
+
+  for (i = 0; i < BENCH_ITERS; i++)
+    {
+      uint64_t start = rdtsc ();
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+      stats_add (&s, rdtsc () - start);
+    }
+  sema_down (&pp.exited);
+  stats_print ("sema-pingpong", "", &s);
+}
+
+/* Lock handoff.  The main thread releases a lock that a helper
+   is waiting for; each sample runs from lock_release() to the
+   helper returning from lock_acquire().  A helper of higher
+   priority donates to the main thread and preempts it on
+   release; one of equal priority runs once the main thread
+   blocks. */
+struct handoff
+  {
+    struct lock lock;           /* Lock handed off. */
+    struct semaphore start;     /* Main thread -> helper. */
+    struct semaphore done;      /* Helper -> main thread. */
+    uint64_t acquired;          /* When the helper got LOCK. */
+  };
+
+static void
+handoff_thread (void *h_)
+{
+  struct handoff *h = h_;
+  int i;
+
+  for (i = 0; i < BENCH_ITERS; i++)
+    {
+      sema_down (&h->start);
+      lock_acquire (&h->lock);
+      h->acquired = rdtsc ();
+      lock_release (&h->lock);
+      sema_up (&h->done);
+    }
+}
+
+static void
+bench_lock_handoff (bool donate)
+{
+  struct handoff h;
+  struct bench_stats s;
+  int i;
+
+  lock_init (&h.lock);
+  sema_init (&h.start, 0);
+  sema_init (&h.done, 0);
+  stats_init (&s);
+  bench_spawn ("handoff", thread_get_priority () + (donate ? 1 : 0),
+               handoff_thread, &h);
+
+  for (i = 0; i < BENCH_ITERS; i++)
+    {
+      uint64_t start;
+
+      lock_acquire (&h.lock);
+      sema_up (&h.start);
+      while (wait_queue_empty (&h.lock.semaphore.waiters))
+        thread_yield ();
+      start = rdtsc ();
+      lock_release (&h.lock);
+      sema_down (&h.done);
+      stats_add (&s, h.acquired - start);
+    }
+  stats_print ("lock-handoff", donate ? "donation=1" : "donation=0", &s);
+}
+
+/* Donation fan-in.  WAITERS threads, each of higher priority
+   than the last, block on a lock the main thread holds, each
+   donating to it.  Each sample runs from the main thread's
+   lock_release() to the best waiter returning from lock_acquire(),
+   which includes dropping all the donations. */
+struct fanin
+  {
+    struct lock lock;           /* Lock waited for. */
+    struct semaphore exited;    /* A waiter is done. */
+    bool first;                 /* No waiter got LOCK yet this round. */
+    uint64_t acquired;          /* When the first one did. */
+  };
+
+static void
+fanin_thread (void *f_)
+{
+  struct fanin *f = f_;
+
+  lock_acquire (&f->lock);
+  if (f->first)
+    {
+      f->first = false;
+      f->acquired = rdtsc ();
+    }
+  lock_release (&f->lock);
+  sema_up (&f->exited);
+}
+
+static void
+bench_donation_fanin (int waiters)
+{
+  int priority = thread_get_priority ();
+  struct fanin f;
+  struct bench_stats s;
+  char params[32];
+  int i, r;
+
+  lock_init (&f.lock);
+  sema_init (&f.exited, 0);
+  stats_init (&s);
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+      uint64_t start;
+
+      lock_acquire (&f.lock);
+      f.first = true;
+      for (i = 1; i <= waiters; i++)
+        bench_spawn ("fanin", bench_priority (priority, i), fanin_thread, &f);
+      start = rdtsc ();
+      lock_release (&f.lock);
+      for (i = 0; i < waiters; i++)
+        sema_down (&f.exited);
+      stats_add (&s, f.acquired - start);
+    }
+  snprintf (params, sizeof params, "waiters=%d", waiters);
+  stats_print ("donation-fanin", params, &s);
+}
+
+/* Nested donation.  Thread i of DEPTH, each of higher priority
+   than the last, holds lock i and waits for lock i - 1, and the
+   main thread holds lock 0.  Then a thread of higher priority
+   still waits for lock DEPTH, and its donation has to travel
+   down the whole chain to the main thread.  Each sample runs
+   from that thread calling lock_acquire() to the main thread,
+   now at its priority, running again. */
+#define NEST_DEPTH_MAX 8
+
+struct nest
+  {
+    struct lock locks[NEST_DEPTH_MAX + 1];      /* Lock i is held by
+                                                   thread i. */
+    struct semaphore exited;    /* A thread is done. */
+    int depth;                  /* # of chained threads. */
+    uint64_t start;             /* When the top thread asked. */
+  };
+
+/* Thread I of the chain, or the top thread if I is DEPTH + 1. */
+struct nest_link
+  {
+    struct nest *nest;
+    int i;
+  };
+
+static void
+nest_thread (void *link_)
+{
+  struct nest_link *link = link_;
+  struct nest *n = link->nest;
+  int i = link->i;
+
+  if (i <= n->depth)
+    lock_acquire (&n->locks[i]);
+  else
+    n->start = rdtsc ();
+  lock_acquire (&n->locks[i - 1]);
+  lock_release (&n->locks[i - 1]);
+  if (i <= n->depth)
+    lock_release (&n->locks[i]);
+  sema_up (&n->exited);
+}
+
+static void
+bench_donation_nest (int depth)
+{
+  int priority = thread_get_priority ();
+  struct nest n;
+  struct nest_link links[NEST_DEPTH_MAX + 2];
+  struct bench_stats s;
+  char params[32];
+  int i, r;
+
+  ASSERT (depth >= 1 && depth <= NEST_DEPTH_MAX);
+
+  for (i = 0; i <= depth; i++)
+    lock_init (&n.locks[i]);
+  sema_init (&n.exited, 0);
+  n.depth = depth;
+  stats_init (&s);
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+      lock_acquire (&n.locks[0]);
+      for (i = 1; i <= depth + 1; i++)
+        {
+          links[i].nest = &n;
+          links[i].i = i;
+          bench_spawn ("nest", bench_priority (priority, i), nest_thread,
+                       &links[i]);
+        }
+      stats_add (&s, rdtsc () - n.start);
+      lock_release (&n.locks[0]);
+      for (i = 1; i <= depth + 1; i++)
+        sema_down (&n.exited);
+    }
+  snprintf (params, sizeof params, "depth=%d", depth);
+  stats_print ("donation-nest", params, &s);
+}
+
+/* timer_sleep() wakeup jitter.  Each round, the main thread waits
+   for a tick to begin and has every sleeper sleep until a few
+   ticks later.  Each sample is how long after that tick began,
+   extrapolated with the calibrated TSC rate, a sleeper got to
+   run again. */
+#define JITTER_AHEAD 3                  /* Ticks from round start to wakeup. */
+
+struct jitter
+  {
+    struct semaphore start;     /* Main thread -> sleepers. */
+    struct semaphore done;      /* Sleeper woke up. */
+    int64_t wake_tick;          /* Tick to wake at. */
+    uint64_t wake_tsc;          /* TSC at the start of WAKE_TICK. */
+    struct bench_stats stats;   /* Wakeup delays. */
+  };
+
+static void
+jitter_thread (void *j_)
+{
+  struct jitter *j = j_;
+  int r;
+
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+      sema_down (&j->start);
+      timer_sleep (j->wake_tick - timer_ticks ());
+      stats_add (&j->stats, rdtsc () - j->wake_tsc);
+      sema_up (&j->done);
+    }
+}
+
+static void
+bench_sleep_jitter (int sleepers)
+{
+  uint64_t tsc_per_tick = timer_tsc_hz () / TIMER_FREQ;
+  struct jitter j;
+  char params[32];
+  int i, r;
+
+  sema_init (&j.start, 0);
+  sema_init (&j.done, 0);
+  stats_init (&j.stats);
+  for (i = 0; i < sleepers; i++)
+    bench_spawn ("sleeper", thread_get_priority () + 1, jitter_thread, &j);
+
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+      int64_t start = timer_ticks (), tick;
+
+      while ((tick = timer_ticks ()) == start)
+        continue;
+      j.wake_tsc = rdtsc () + JITTER_AHEAD * tsc_per_tick;
+      j.wake_tick = tick + JITTER_AHEAD;
+      for (i = 0; i < sleepers; i++)
+        sema_up (&j.start);
+      for (i = 0; i < sleepers; i++)
+        sema_down (&j.done);
+    }
+  snprintf (params, sizeof params, "sleepers=%d", sleepers);
+  stats_print ("sleep-jitter", params, &j.stats);
+}
+
+/* Wakeup preemption.  A sleeper of higher priority sleeps for one
+   tick at a time while the main thread keeps the CPU busy, so
+   each wakeup happens in the timer interrupt on top of a running
+   thread.  Each sample is how long after its wakeup tick the
+   sleeper got to run; under-tick=1 means every one was under a
+   tick, that is, the interrupt preempted the busy thread instead
+   of leaving the sleeper for its time slice to expire. */
+struct wake_preempt
+  {
+    struct semaphore done;      /* Sleeper is done. */
+    struct bench_stats stats;   /* Wakeup delays. */
+  };
+
+static void
+wake_preempt_thread (void *wp_)
+{
+  struct wake_preempt *wp = wp_;
+  uint64_t tsc_per_tick = timer_tsc_hz () / TIMER_FREQ;
+  int r;
+
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+      int64_t wake = timer_ticks () + 1;
+      uint64_t tick_tsc;
+      int64_t tick;
+
+      timer_sleep (1);
+      tick = timer_ticks_tsc (&tick_tsc);
+      stats_add (&wp->stats, rdtsc () - tick_tsc
+                             + (tick - wake) * tsc_per_tick);
+    }
+  sema_up (&wp->done);
+}
+
+static void
+bench_wake_preempt (void)
+{
+  struct wake_preempt wp;
+  char params[32];
+
+  sema_init (&wp.done, 0);
+  stats_init (&wp.stats);
+  bench_spawn ("sleeper", thread_get_priority () + 1, wake_preempt_thread,
+               &wp);
+  while (!sema_try_down (&wp.done))
+    continue;
+  snprintf (params, sizeof params, "under-tick=%d",
+            wp.stats.n > 0
+            && wp.stats.max < (int64_t) (timer_tsc_hz () / TIMER_FREQ));
+  stats_print ("wake-preempt", params, &wp.stats);
+}
+
+/* Timer tick cost against the number of sleepers.  Sleepers wait
+   on a semaphore with timeouts spread over several seconds, which
+   keeps them in the sleep wheel at every level, while the main
+   thread samples the cycles each timer tick spends in its
+   per-tick work.  Then it wakes them all through the semaphore.
+   The cost should not grow with the number of sleepers. */
+#define TICK_SAMPLES 200                /* Ticks sampled. */
+
+struct tick_cost
+  {
+    struct semaphore release;   /* Ends the sleepers' waits. */
+    struct semaphore exited;    /* A sleeper is done. */
+  };
+
+static void
+tick_cost_thread (void *tc_)
+{
+  struct tick_cost *tc = tc_;
+  int64_t timeout = TICK_SAMPLES + 10 + thread_tid () * 37 % (40 * TIMER_FREQ);
+
+  sema_down_timeout (&tc->release, timeout);
+  sema_up (&tc->exited);
+}
+
+static void
+bench_tick_cost (int sleepers)
+{
+  struct tick_cost tc;
+  struct bench_stats s;
+  char params[32];
+  int i;
+
+  sema_init (&tc.release, 0);
+  sema_init (&tc.exited, 0);
+  stats_init (&s);
+  for (i = 0; i < sleepers; i++)
+    bench_spawn ("sleeper", thread_get_priority () + 1, tick_cost_thread, &tc);
+
+  for (i = 0; i < TICK_SAMPLES; i++)
+    {
+      int64_t start = timer_ticks ();
+
+      while (timer_ticks () == start)
+        continue;
+      stats_add (&s, timer_last_tick_cycles ());
+    }
+  for (i = 0; i < sleepers; i++)
+    sema_up (&tc.release);
+  for (i = 0; i < sleepers; i++)
+    sema_down (&tc.exited);
+  snprintf (params, sizeof params, "sleepers=%d", sleepers);
+  stats_print ("tick-cost", params, &s);
+}
+
+/* Starvation under strict priorities.  Each round, a thread of
+   lower priority than the main thread becomes ready, and then a
+   hog of higher priority spins for STARVE_TICKS.  Each sample is
+   how long the low-priority thread waited to run.  Without aging
+   that is the whole spin; with it, the thread climbs to the hog's
+   priority in two aging steps and then shares the CPU with it. */
+#define STARVE_TICKS 50                 /* Length of the hog's spin. */
+#define STARVE_AGING_TICKS 5            /* thread_aging_ticks meanwhile. */
+#define STARVE_ROUNDS 5
+
+struct starve
+  {
+    struct semaphore done;      /* Hog or victim is done. */
+    uint64_t ran;               /* When the victim got to run. */
+  };
+
+static void
+starve_hog (void *s_)
+{
+  struct starve *s = s_;
+  int64_t start = timer_ticks ();
+
+  while (timer_elapsed (start) < STARVE_TICKS)
+    continue;
+  sema_up (&s->done);
+}
+
+static void
+starve_victim (void *s_)
+{
+  struct starve *s = s_;
+
+  s->ran = rdtsc ();
+  sema_up (&s->done);
+}
+
+static void
+bench_starvation (bool aging)
+{
+  bool old_aging = thread_aging;
+  unsigned old_aging_ticks = thread_aging_ticks;
+  int priority = thread_get_priority ();
+  struct starve s;
+  struct bench_stats stats;
+  char params[32];
+  int r;
+
+  sema_init (&s.done, 0);
+  stats_init (&stats);
+  thread_aging = aging;
+  thread_aging_ticks = STARVE_AGING_TICKS;
+  for (r = 0; r < STARVE_ROUNDS; r++)
+    {
+      uint64_t ready = rdtsc ();
+
+      bench_spawn ("victim", priority - 1, starve_victim, &s);
+      bench_spawn ("hog", priority + 1, starve_hog, &s);
+      sema_down (&s.done);
+      sema_down (&s.done);
+      stats_add (&stats, s.ran - ready);
+    }
+  thread_aging = old_aging;
+  thread_aging_ticks = old_aging_ticks;
+
+  snprintf (params, sizeof params, "aging=%d aging-ticks=%d",
+            aging, STARVE_AGING_TICKS);
+  stats_print ("starvation", params, &stats);
+}
+
+/* Mixed workload under a given time slice.  MIX_BATCH CPU-bound
+   threads and one interactive thread, all of the same priority,
+   share the CPU for MIX_TICKS.  The interactive thread sleeps for
+   a tick at a time and then does a short burst of work; each
+   sample is how long after its wakeup tick it got to run, which
+   grows with the slice of the batch thread it waits behind.  The
+   line also reports context switches and batch work per second. */
+#define MIX_BATCH 2                     /* CPU-bound threads. */
+#define MIX_TICKS 100                   /* Length of the run. */
+#define MIX_BURST 1000                  /* Loops of interactive work. */
+
+struct slice_mix
+  {
+    struct semaphore exited;    /* A thread is done. */
+    int64_t start;              /* Tick the run started. */
+    int64_t work;               /* Loops done by the batch threads. */
+    int64_t switches;           /* Context switches of all threads. */
+    struct bench_stats stats;   /* Interactive wakeup delays. */
+  };
+
+/* Adds the current thread's context switches to MIX. */
+static void
+slice_mix_count_switches (struct slice_mix *mix)
+{
+  struct thread_stats st;
+  enum intr_level old_level;
+
+  thread_get_stats (thread_tid (), &st);
+  old_level = intr_disable ();
+  mix->switches += st.voluntary_switches + st.involuntary_switches;
+  intr_set_level (old_level);
+}
+
+static void
+slice_mix_batch (void *mix_)
+{
+  struct slice_mix *mix = mix_;
+  volatile int64_t work = 0;
+  enum intr_level old_level;
+
+  while (timer_elapsed (mix->start) < MIX_TICKS)
+    work++;
+  old_level = intr_disable ();
+  mix->work += work;
+  intr_set_level (old_level);
+  slice_mix_count_switches (mix);
+  sema_up (&mix->exited);
+}
+
+static void
+slice_mix_interactive (void *mix_)
+{
+  struct slice_mix *mix = mix_;
+  uint64_t tsc_per_tick = timer_tsc_hz () / TIMER_FREQ;
+
+  while (timer_elapsed (mix->start) < MIX_TICKS)
+    {
+      int64_t wake = timer_ticks () + 1;
+      uint64_t tick_tsc;
+      int64_t tick;
+      volatile int i;
+
+      timer_sleep (1);
+      tick = timer_ticks_tsc (&tick_tsc);
+      stats_add (&mix->stats, rdtsc () - tick_tsc
+                              + (tick - wake) * tsc_per_tick);
+      for (i = 0; i < MIX_BURST; i++)
+        continue;
+    }
+  slice_mix_count_switches (mix);
+  sema_up (&mix->exited);
+}
+
+static void
+bench_slice_mix (unsigned slice)
+{
+  int band_size = (PRI_MAX - PRI_MIN + 1) / SLICE_BANDS;
+  unsigned old_slice[SLICE_BANDS];
+  struct slice_mix mix;
+  char params[96];
+  int i;
+
+  for (i = 0; i < SLICE_BANDS; i++)
+    {
+      old_slice[i] = thread_get_slice (PRI_MIN + i * band_size);
+      thread_set_slice (i, slice);
+    }
+
+  sema_init (&mix.exited, 0);
+  mix.start = timer_ticks ();
+  mix.work = 0;
+  mix.switches = 0;
+  stats_init (&mix.stats);
+  for (i = 0; i < MIX_BATCH; i++)
+    bench_spawn ("batch", thread_get_priority () + 1, slice_mix_batch, &mix);
+  bench_spawn ("interactive", thread_get_priority () + 1,
+               slice_mix_interactive, &mix);
+  for (i = 0; i < MIX_BATCH + 1; i++)
+    sema_down (&mix.exited);
+
+  for (i = 0; i < SLICE_BANDS; i++)
+    thread_set_slice (i, old_slice[i]);
+
+  snprintf (params, sizeof params,
+            "slice=%u switches-per-sec=%"PRId64" work-per-sec=%"PRId64,
+            slice, mix.switches * TIMER_FREQ / MIX_TICKS,
+            mix.work * TIMER_FREQ / MIX_TICKS);
+  stats_print ("slice-mix", params, &mix.stats);
+}
+
+/* thread_create()/exit throughput.  Each round creates BATCH
+   threads of higher priority, each of which runs at once and waits
+   to be let go, then lets them go one at a time; each signals and
+   exits.  Each sample is a round's cycles divided by BATCH.  A
+   batch larger than the thread page cache shows the cost of
+   falling back to the page allocator. */
+struct churn
+  {
+    struct semaphore go;        /* Lets one thread exit. */
+    struct semaphore done;      /* A thread is about to exit. */
+  };
+
+static void
+churn_thread (void *c_)
+{
+  struct churn *c = c_;
+
+  sema_down (&c->go);
+  sema_up (&c->done);
+}
+
+static void
+bench_thread_churn (int batch)
+{
+  struct churn c;
+  struct bench_stats s;
+  char params[64];
+  int i, r;
+
+  sema_init (&c.go, 0);
+  sema_init (&c.done, 0);
+  stats_init (&s);
+  for (r = 0; r < BENCH_ITERS / batch; r++)
+    {
+      uint64_t start = rdtsc ();
+
+      for (i = 0; i < batch; i++)
+        bench_spawn ("churn", thread_get_priority () + 1, churn_thread, &c);
+      for (i = 0; i < batch; i++)
+        {
+          sema_up (&c.go);
+          sema_down (&c.done);
+        }
+      stats_add (&s, (rdtsc () - start) / batch);
+    }
+  snprintf (params, sizeof params, "batch=%d threads-per-sec=%"PRId64,
+            batch, s.sum > 0 ? (int64_t) timer_tsc_hz () * s.n / s.sum : 0);
+  stats_print ("thread-churn", params, &s);
+}
+
+/* cond_broadcast() fan-out.  Helpers of higher priority wait on a
+   condition; each sample runs from cond_broadcast() to the last
+   of them getting the lock back. */
+struct fanout
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition cond;      /* Broadcast each round. */
+    struct semaphore ready;     /* A helper is about to wait. */
+    struct semaphore done;      /* Last helper got the lock. */
+    struct semaphore exited;    /* A helper is done. */
+    int waiters;                /* # of helpers. */
+    int woken;                  /* # that got the lock this round. */
+    unsigned gen;               /* Round number. */
+    uint64_t last;              /* When the last one got the lock. */
+  };
+
+static void
+fanout_thread (void *f_)
+{
+  struct fanout *f = f_;
+  int r;
+
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+      unsigned gen;
+      bool last;
+
+      lock_acquire (&f->lock);
+      gen = f->gen;
+      sema_up (&f->ready);
+      while (f->gen == gen)
+        cond_wait (&f->cond, &f->lock);
+      last = ++f->woken == f->waiters;
+      if (last)
+        f->last = rdtsc ();
+      lock_release (&f->lock);
+      if (last)
+        sema_up (&f->done);
+    }
+  sema_up (&f->exited);
+}
+
+static void
+bench_cond_fanout (int waiters)
+{
+  struct fanout f;
+  struct bench_stats s;
+  char params[32];
+  int i, r;
+
+  lock_init (&f.lock);
+  cond_init (&f.cond);
+  sema_init (&f.ready, 0);
+  sema_init (&f.done, 0);
+  sema_init (&f.exited, 0);
+  f.waiters = waiters;
+  f.gen = 0;
+  stats_init (&s);
+  for (i = 0; i < waiters; i++)
+    bench_spawn ("fanout", thread_get_priority () + 1, fanout_thread, &f);
+
+  for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+      uint64_t start;
+
+      for (i = 0; i < waiters; i++)
+        sema_down (&f.ready);
+      lock_acquire (&f.lock);
+      f.woken = 0;
+      f.gen++;
+      start = rdtsc ();
+      cond_broadcast (&f.cond, &f.lock);
+      lock_release (&f.lock);
+      sema_down (&f.done);
+      stats_add (&s, f.last - start);
+    }
+  for (i = 0; i < waiters; i++)
+    sema_down (&f.exited);
+  snprintf (params, sizeof params, "waiters=%d", waiters);
+  stats_print ("cond-fanout", params, &s);
+}
+
+/* Runs every benchmark and prints the results, see the top of
+   this file.  Called from main() once the scheduler and the timer
+   are up, when "-o bench" is given. */
+void
+sched_bench_run (void)
+{
+  /* The wakeup benchmarks assume due sleeps wake on the next tick. */
+  timer_sleep_self_test ();
+  printf ("BENCH-BEGIN %"PRIu64"\n", timer_tsc_hz ());
+  bench_sema_pingpong ();
+  bench_lock_handoff (false);
+  bench_lock_handoff (true);
+  bench_donation_fanin (1);
+  bench_donation_fanin (8);
+  bench_donation_fanin (32);
+  bench_donation_nest (1);
+  bench_donation_nest (4);
+  bench_donation_nest (NEST_DEPTH_MAX);
+  bench_sleep_jitter (1);
+  bench_sleep_jitter (16);
+  bench_sleep_jitter (64);
+  bench_wake_preempt ();
+  bench_tick_cost (0);
+  bench_tick_cost (32);
+  bench_tick_cost (256);
+  if (!thread_mlfqs && !thread_stride)
+    {
+      /* Aging only applies to the priority scheduler. */
+      bench_starvation (false);
+      bench_starvation (true);
+    }
+  bench_slice_mix (1);
+  bench_slice_mix (4);
+  bench_slice_mix (16);
+  bench_thread_churn (1);
+  bench_thread_churn (16);
+  bench_thread_churn (64);
+  bench_cond_fanout (1);
+  bench_cond_fanout (8);
+  bench_cond_fanout (64);
+  printf ("BENCH-END\n");
+}
@@ -0,0 +1,25 @@
+#ifndef THREADS_SCHED_BENCH_H
+#define THREADS_SCHED_BENCH_H
+
+#include <stdbool.h>
+
+/* If true, run the scheduler and synchronization benchmarks at
+   boot, see sched_bench_run().
+   Controlled by kernel command-line option "-o bench". */
+extern bool sched_bench_enabled;
+
+/* Runs the benchmarks.  Call it from threads/init.c, which is not
+   part of this tree, once interrupts are on and the timer is
+   calibrated.  In parse_options(), next to the other "-o" options:
+
+     else if (!strcmp (name, "-o") && !strcmp (value, "bench"))
+       sched_bench_enabled = true;
+
+   and in main(), right after timer_calibrate():
+
+     if (sched_bench_enabled)
+       sched_bench_run ();
+*/
+void sched_bench_run (void);
+
+#endif /* threads/sched-bench.h */
@@ -0,0 +1,95 @@
+#include "threads/sched-trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Per-boot ring buffer of scheduler events.  Once full, new
+   records overwrite the oldest ones, so the dump always holds
+   the last TRACE_CNT events before shutdown. */
+#define TRACE_CNT 4096                  /* Power of 2. */
+static struct sched_trace_rec trace_buf[TRACE_CNT];
+static uint32_t trace_head;             /* # of records ever written. */
+
+/* Thread names, for tids below TRACE_NAME_CNT. */
+#define TRACE_NAME_CNT 256
+static char trace_names[TRACE_NAME_CNT][16];
+
+/* TSC at sched_trace_init(), to estimate the TSC rate at dump
+   time against timer ticks. */
+static uint64_t trace_start_tsc;
+
+bool sched_trace_enabled;
+
+/* Initializes the trace buffer.  Called from thread_init(). */
+void
+sched_trace_init (void)
+{
+  trace_head = 0;
+  trace_start_tsc = rdtsc ();
+}
+
+/* Appends an EVENT about thread T, with event-specific ARG, to
+   the trace buffer.  May be called from an interrupt handler. */
+void
+sched_trace_record (enum sched_trace_event event, const struct thread *t,
+                    int arg)
+{
+  struct sched_trace_rec *r;
+  enum intr_level old_level;
+
+  if (!sched_trace_enabled)
+    return;
+
+  old_level = intr_disable ();
+  r = &trace_buf[trace_head++ % TRACE_CNT];
+  r->tsc = rdtsc ();
+  r->tid = t->tid;
+  r->event = event;
+  r->priority = t->priority;
+  r->arg = arg;
+  intr_set_level (old_level);
+}
+
+/* Remembers NAME for thread TID, for the dump. */
+void
+sched_trace_name (int tid, const char *name)
+{
+  if (sched_trace_enabled && tid >= 0 && tid < TRACE_NAME_CNT)
+    strlcpy (trace_names[tid], name, sizeof trace_names[tid]);
+}
+
+/* Prints the trace buffer to the console, which includes the
+   serial port, one line per record between marker lines that
+   utils/sched-trace-to-json picks out of the output. */
+void
+sched_trace_dump (void)
+{
+  int64_t ticks = timer_ticks ();
+  uint64_t tsc_hz = 0;
+  uint32_t first, i;
+  int tid;
+
+  if (!sched_trace_enabled)
+    return;
+
+  if (ticks > 0)
+    tsc_hz = (rdtsc () - trace_start_tsc) * TIMER_FREQ / ticks;
+  first = trace_head > TRACE_CNT ? trace_head - TRACE_CNT : 0;
+
+  printf ("SCHED-TRACE-BEGIN %"PRIu32" %"PRIu64"\n",
+          trace_head - first, tsc_hz);
+  for (tid = 0; tid < TRACE_NAME_CNT; tid++)
+    if (trace_names[tid][0] != '\0')
+      printf ("N %d %s\n", tid, trace_names[tid]);
+  for (i = first; i != trace_head; i++)
+    {
+      const struct sched_trace_rec *r = &trace_buf[i % TRACE_CNT];
+      printf ("R %016"PRIx64" %"PRId32" %u %u %u\n",
+              r->tsc, r->tid, r->event, r->priority, r->arg);
+    }
+  printf ("SCHED-TRACE-END\n");
+}
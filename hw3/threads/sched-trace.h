@@ -0,0 +1,44 @@
+#ifndef THREADS_SCHED_TRACE_H
+#define THREADS_SCHED_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+
+struct thread;
+
+/* Scheduler trace event types.  utils/sched-trace-to-json knows
+   these values; keep the two in sync. */
+enum sched_trace_event
+  {
+    TRACE_SWITCH,       /* Thread switched out, ARG = next tid. */
+    TRACE_RUN,          /* Thread starts running, ARG = previous tid. */
+    TRACE_BLOCK,        /* Thread blocks itself. */
+    TRACE_UNBLOCK,      /* Thread made ready, ARG = waker's tid. */
+    TRACE_DONATE,       /* Thread's priority changed by donation,
+                           ARG = donor's tid. */
+    TRACE_WAKE,         /* Thread woken from timer_sleep(). */
+    TRACE_EXIT          /* Thread exits. */
+  };
+
+/* One trace record.  Kept at 16 bytes. */
+struct sched_trace_rec
+  {
+    uint64_t tsc;               /* Time stamp counter. */
+    int32_t tid;                /* Thread the event is about. */
+    uint8_t event;              /* enum sched_trace_event. */
+    uint8_t priority;           /* Thread's priority after the event. */
+    uint16_t arg;               /* Event-specific tid, see above. */
+  };
+
+/* If true, record scheduler events.
+   Controlled by kernel command-line option "-o trace". */
+extern bool sched_trace_enabled;
+
+void sched_trace_init (void);
+void sched_trace_record (enum sched_trace_event, const struct thread *,
+                         int arg);
+void sched_trace_name (int tid, const char *name);
+void sched_trace_dump (void);
+
+#endif /* threads/sched-trace.h */
@@ -29,9 +29,144 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
+#include "threads/sched-trace.h"
 #include "threads/thread.h"
 
+static bool wait_node_less (const struct heap_elem *,
+                            const struct heap_elem *, void *aux);
+static void wait_queue_catch_up (struct wait_queue *);
+
+/* Initializes wait queue WQ as empty. */
+void
+wait_queue_init (struct wait_queue *wq)
+{
+  heap_init (&wq->heap, wait_node_less, NULL);
+  wq->next_seq = 0;
+  wq->epoch = thread_mlfqs_epoch ();
+}
+
+/* Returns true if no thread waits in WQ. */
+bool
+wait_queue_empty (const struct wait_queue *wq)
+{
+  return heap_empty (&wq->heap);
+}
+
+/* Queues NODE in WQ on behalf of thread T.  Interrupts must be
+   off, and must stay off until NODE leaves WQ. */
+void
+wait_queue_push (struct wait_queue *wq, struct wait_node *node,
+                 struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (node->queue == NULL);
+
+  if (thread_mlfqs)
+    thread_mlfqs_catch_up (t);
+  node->thread = t;
+  node->seq = wq->next_seq++;
+  node->queue = wq;
+  heap_insert (&wq->heap, &node->elem);
+}
+
+/* Removes and returns the highest-priority waiter of WQ, which
+   must not be empty. */
+struct wait_node *
+wait_queue_pop (struct wait_queue *wq)
+{
+  struct wait_node *node;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  node = heap_entry (heap_pop_min (&wq->heap), struct wait_node, elem);
+  node->queue = NULL;
+  return node;
+}
+
+/* Puts NODE, just popped from WQ and still waiting, back in WQ in
+   the place it had, ahead of waiters that arrived after it. */
+void
+wait_queue_requeue (struct wait_queue *wq, struct wait_node *node)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (node->queue == NULL);
+
+  node->queue = wq;
+  heap_insert (&wq->heap, &node->elem);
+}
+
+/* Takes NODE out of the queue it waits in, if any, as when a
+   waiter gives up before it is woken. */
+void
+wait_queue_remove (struct wait_node *node)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (node->queue != NULL)
+    {
+      heap_remove (&node->queue->heap, &node->elem);
+      node->queue = NULL;
+    }
+}
+
+/* Moves NODE to its place for its thread's new priority, if it
+   is queued.  Called by thread_update_priority(). */
+void
+wait_node_update (struct wait_node *node)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (node->queue != NULL)
+    heap_update (&node->queue->heap, &node->elem);
+}
+
+/* Orders a wait queue: higher priority first, then earlier
+   arrival. */
+static bool
+wait_node_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                void *aux UNUSED)
+{
+  const struct wait_node *a = heap_entry (a_, struct wait_node, elem);
+  const struct wait_node *b = heap_entry (b_, struct wait_node, elem);
+
+  if (a->thread->priority != b->thread->priority)
+    return a->thread->priority > b->thread->priority;
+  return (int) (a->seq - b->seq) < 0;
+}
+
+/* Under the MLFQS, a blocked thread's priority is only brought
+   up to date lazily, so catch every waiter of WQ up before the
+   best one is chosen.  Waiters are caught up when they are queued,
+   so this is needed only once per second per queue, the first time
+   WQ is woken after an update; later wakeups in the same second
+   find WQ already in order.  Each waiter is moved through a second
+   heap so that none is in WQ while thread_mlfqs_catch_up() changes
+   its priority. */
+static void
+wait_queue_catch_up (struct wait_queue *wq)
+{
+  struct heap caught;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (wq->epoch == thread_mlfqs_epoch ())
+    return;
+  wq->epoch = thread_mlfqs_epoch ();
+
+  heap_init (&caught, wait_node_less, NULL);
+  while (!heap_empty (&wq->heap))
+    {
+      struct wait_node *node = wait_queue_pop (wq);
+      thread_mlfqs_catch_up (node->thread); // 밀린 recent_cpu decay 반영 후 비교
+      heap_insert (&caught, &node->elem);
+    }
+  while (!heap_empty (&caught))
+    wait_queue_requeue (wq, heap_entry (heap_pop_min (&caught),
+                                        struct wait_node, elem));
+}
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -47,22 +182,10 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  wait_queue_init (&sema->waiters);
 }
 
 
-bool compare_sema_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-  struct semaphore_elem *a_sema = list_entry(a, struct semaphore_elem, elem);
-  struct semaphore_elem *b_sema = list_entry(b, struct semaphore_elem, elem);
-
-  struct list *a_list = &(a_sema->semaphore.waiters);
-  struct list *b_list = &(b_sema->semaphore.waiters);
-
-  return list_entry(list_begin(a_list), struct thread, elem)->priority > list_entry(list_begin(b_list), struct thread, elem)->priority;
-
-} // semaphore의 thread priority 비교 (가장 높은 priority의 thread를 가진 semaphore를 깨우기 위함). a > b이면 true
-
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
    to become positive and then atomically decrements it.
 
@@ -81,8 +204,8 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      //list_push_back (&sema->waiters, &thread_current ()->elem);
-      list_insert_ordered (&sema->waiters, &thread_current ()->elem, compare_thread_priority, 0); //wake되는 thread의 priority 정렬
+      struct thread *cur = thread_current ();
+      wait_queue_push (&sema->waiters, &cur->sema_node, cur); // priority 순서로 wake
       thread_block ();
     }
   sema->value--;
@@ -115,6 +238,43 @@ sema_try_down (struct semaphore *sema)
   return success;
 }
 
+/* Down or "P" operation on a semaphore, giving up after TICKS
+   timer ticks.  Returns true if SEMA was decremented, false if
+   the time ran out first.  A TICKS of 0 or less only tries once,
+   like sema_try_down().
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks)
+{
+  struct thread *cur = thread_current ();
+  int64_t deadline = timer_ticks () + ticks;
+  enum intr_level old_level;
+
+  ASSERT (sema != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  while (sema->value == 0)
+    {
+      if (timer_ticks () >= deadline)
+        {
+          intr_set_level (old_level);
+          return false;
+        }
+      wait_queue_push (&sema->waiters, &cur->sema_node, cur);
+      if (thread_block_timeout (&cur->sema_node, deadline))
+        {
+          intr_set_level (old_level);
+          return false;
+        }
+    }
+  sema->value--;
+  intr_set_level (old_level);
+  return true;
+}
+
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
    and wakes up one thread of those waiting for SEMA, if any.
 
@@ -127,10 +287,10 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) {
-    list_sort(&sema->waiters, &compare_thread_priority, NULL); // waiters list를 priority 순서대로 정렬
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+  if (!wait_queue_empty (&sema->waiters)) {
+    if (thread_mlfqs)
+      wait_queue_catch_up (&sema->waiters);
+    thread_unblock (wait_queue_pop (&sema->waiters)->thread); // 가장 높은 priority의 waiter
   }
   sema->value++;
   yield_to_max(); // 더 높은 priority 가진 thread가 있다면 yield(preemption)
@@ -138,6 +298,21 @@ sema_up (struct semaphore *sema)
 }
 
 static void sema_test_helper (void *sema_);
+static void donate_priority (struct lock *);
+static void lock_wait_begin (struct lock *);
+static void lock_wait_end (struct lock *, bool acquired);
+static void lock_take (struct lock *);
+static int donation_value (const struct thread *);
+static inline int64_t lock_profile_now (void);
+static inline void lock_profile_contended (struct lock *);
+static inline void lock_profile_donated (struct lock *);
+static inline void lock_profile_waited (struct lock *, int64_t start);
+static inline void lock_profile_taken (struct lock *);
+static inline void lock_profile_released (struct lock *);
+static bool donor_less (const struct heap_elem *, const struct heap_elem *,
+                        void *aux);
+static int rwlock_reader_donation (const struct thread *);
+static void rwlock_donate_readers (struct rwlock *);
 
 /* Self-test for semaphores that makes control "ping-pong"
    between a pair of threads.  Insert calls to printf() to see
@@ -196,6 +371,10 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  heap_init (&lock->donors, donor_less, NULL);
+#ifdef LOCK_PROFILE
+  memset (&lock->stats, 0, sizeof lock->stats);
+#endif
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -209,71 +388,214 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  int64_t start = lock_profile_now ();
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
   
+  lock_wait_begin (lock);
+  sema_down (&lock->semaphore);
+  lock_wait_end (lock, true);
+  lock_profile_waited (lock, start);
+}
+
+/* Acquires LOCK like lock_acquire(), but gives up after TICKS
+   timer ticks.  Returns true if LOCK was acquired.  If the wait
+   times out, the donation it made is withdrawn again all along
+   the chain of holders.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+lock_acquire_timeout (struct lock *lock, int64_t ticks)
+{
+  int64_t start = lock_profile_now ();
+  bool success;
+
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!lock_held_by_current_thread (lock));
+
+  lock_wait_begin (lock);
+  success = sema_down_timeout (&lock->semaphore, ticks);
+  lock_wait_end (lock, success);
+  if (success)
+    lock_profile_waited (lock, start);
+  return success;
+}
+
+/* The current thread is about to wait for LOCK: donate to its
+   holder, if any. */
+static void
+lock_wait_begin (struct lock *lock)
+{
   struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   //lock holder가 없으면 holder가 NULL임
+  old_level = intr_disable ();
   if(lock->holder != NULL) {
+    lock_profile_contended (lock);
     cur->waiting_for_this_lock = lock;
-    //priority donation 필요 상황
-      // 단계: init보다 높으면 일단 넣고나서 최종 priority 계산
-      // thread_set_priority 때문에 그냥 다 넣어야할듯
-      list_insert_ordered (&lock->holder->donation_list, &cur->donation_elem, compare_donation_priority, 0);  // priority
-
-      set_priority_for_lock_holder(lock, DEFAULT_DEPTH, DEFAULT_BOOL_DEPTH);
-      //donate(lock->holder); //
-    // 단순히 이렇게 donation하면 이것이 추후에도 괜찮을지 판단 필요
-    // (이것이 영구적인 효과일지 일시적인 효과일지 판단 필요) 
-    // 아마 release에서 원상태로 돌려놓아야함
-
-    // 기본적인 thread struct의 개편이 필요함
-    // 대략 현재 priority, 초기 priority, priority donation 받게 되는 lock과 값
+    heap_insert (&lock->donors, &cur->donor_elem); // lock의 donor heap에 추가
+    donate_priority (lock); // priority donation (nested 포함)
   }
+  intr_set_level (old_level);
+}
 
-  
-  sema_down (&lock->semaphore);
+/* The current thread is done waiting for LOCK, and ACQUIRED says
+   whether it got LOCK's semaphore.  Withdraws its donation and,
+   if ACQUIRED, makes it the holder. */
+static void
+lock_wait_end (struct lock *lock, bool acquired)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (cur->waiting_for_this_lock == lock) {
+    heap_remove (&lock->donors, &cur->donor_elem);
+    if (!acquired)
+      donate_priority (lock); // timeout: holder들의 priority를 다시 낮춤
+  }
   cur->waiting_for_this_lock = NULL;
-  lock->holder = thread_current ();
+  if (acquired)
+    lock_take (lock);
+  intr_set_level (old_level);
 }
 
-/* Priority donation */
+/* Priority donation.  The best donor of LOCK may have changed:
+   a thread started or gave up waiting for it, or a waiter's own
+   priority changed.  Re-places LOCK in its holder's held_locks
+   and recomputes the holder's priority, which is O(log n) in the
+   heaps it touches.  If the holder's priority changes and it
+   waits for a lock itself, thread_update_priority() calls
+   lock_donor_changed() for it, which carries the donation on to
+   the next holder, and so on down the chain until a holder's
+   priority stays the same. */
+static void
+donate_priority (struct lock *lock)
+{
+  struct thread *holder = lock->holder;
+  int before, before_tickets;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (holder == NULL)
+    return;
+  before = holder->priority;
+  before_tickets = holder->tickets;
+
+  heap_update (&holder->held_locks, &lock->holder_elem);
+  thread_refresh_donation (holder); // (nest donation은 lock_donor_changed에서 처리)
+  if (holder->priority != before)
+    sched_trace_record (TRACE_DONATE, holder, thread_current ()->tid);
+  if (holder->priority > before || holder->tickets > before_tickets)
+    lock_profile_donated (lock);
+}
+
+/* Called by thread.c with interrupts off whenever T's priority,
+   or its tickets under the stride scheduler, changes, whether by
+   donation, aging, thread_set_priority() or the MLFQS.  If T waits
+   for a lock, T moves to its new place among the lock's donors and
+   the holder's donation is recomputed; if T is a writer waiting
+   for an rwlock's readers, they get its new priority.  Nested
+   donation recurses through here, at most DEFAULT_DEPTH locks
+   deep.  The MLFQS computes every priority itself and has no
+   donation, so this does nothing there. */
 void
-set_priority_for_lock_holder (struct lock *lock, int depth, int bool_depth) {
-//depth 구현되어 있으나 굳이 구현해야 하나? bool_depth 추가해서 depth 기능 on/off
-  if(bool_depth && depth <= 0) {
+lock_donor_changed (struct thread *t)
+{
+  static int depth;
+  struct lock *lock = t->waiting_for_this_lock;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+  if (lock != NULL)
+    heap_update (&lock->donors, &t->donor_elem);
+  if (DEFAULT_BOOL_DEPTH && depth >= DEFAULT_DEPTH) // bool_depth가 켜져 있으면 depth 제한
     return;
-  }
-  else {
-    depth--;
-  }
-  int before = lock->holder->priority;
-  lock->holder->priority = lock->holder->initial_priority;
-  if(!list_empty(&lock->holder->donation_list)) {
-    //시작 시 sorting을 하고 하면 편할 듯
-    list_sort(&lock->holder->donation_list, compare_donation_priority, NULL); // 정렬(multipli donation 처리)
-    struct thread *t = list_entry (list_begin(&lock->holder->donation_list), struct thread, donation_elem); // 정렬되어 있으니 앞에 있는 것 하나만 체크
-    if(t->priority > lock->holder->priority) {
-        lock->holder->priority = t->priority;
-        ready_list_sort();
-    }
-    if(lock->holder->priority != before && lock->holder->waiting_for_this_lock != NULL) {
-      set_priority_for_lock_holder(lock->holder->waiting_for_this_lock, depth, bool_depth); // (nest donation 처리)
-    }
-    /* 굳이 이렇게 전체를 확인해야하는걸까? 애초에 donation_list는 정렬되어 있는데?
-    struct list_elem *e = list_begin (&lock->holder->donation_list);
-    while (e!=list_end(&thread_current->donation_list) { // current thread의 donation 리스트 순회
-      struct thread *t = list_entry (e, struct thread, donation_elem);
-      if(t->priority > lock->holder->priority) {
-        lock->holder->priority = t->priority;
-      }
-      e = list_next(e);
-    }
-    */
 
-  }
+  depth++;
+  if (lock != NULL)
+    donate_priority (lock);
+  if (t->draining != NULL)
+    rwlock_donate_readers (t->draining); // writer가 기다리는 reader들에게도
+  depth--;
+}
+
+/* Makes the current thread LOCK's holder.  Threads still waiting
+   for LOCK now donate to it. */
+static void
+lock_take (struct lock *lock)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lock->holder = cur;
+  lock_profile_taken (lock);
+  heap_insert (&cur->held_locks, &lock->holder_elem);
+  if (!heap_empty (&lock->donors))
+    thread_refresh_donation (cur);
+}
+
+/* Returns the best donation a waiter of a lock held by T offers:
+   the waiter's tickets under the stride scheduler, otherwise its
+   priority.  A writer waiting for T to stop reading an rwlock
+   counts as a waiter.  Returns -1 if T has no waiters. */
+int
+lock_max_donation (const struct thread *t)
+{
+  const struct heap_elem *e = heap_min (&t->held_locks);
+  int donated = rwlock_reader_donation (t);
+  const struct lock *lock;
+
+  if (e == NULL)
+    return donated;
+  lock = heap_entry (e, struct lock, holder_elem);
+  e = heap_min (&lock->donors);
+  if (e != NULL
+      && donation_value (heap_entry (e, struct thread, donor_elem)) > donated)
+    donated = donation_value (heap_entry (e, struct thread, donor_elem));
+  return donated;
+}
+
+/* What T donates through a lock it waits for. */
+static int
+donation_value (const struct thread *t)
+{
+  return thread_stride ? t->tickets : t->priority;
+}
+
+/* Orders a lock's donors heap, best donation first. */
+static bool
+donor_less (const struct heap_elem *a, const struct heap_elem *b,
+            void *aux UNUSED)
+{
+  return (donation_value (heap_entry (a, struct thread, donor_elem))
+          > donation_value (heap_entry (b, struct thread, donor_elem)));
+}
+
+/* Orders a thread's held_locks heap, the lock with the best
+   donor first. */
+bool
+lock_donation_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                    void *aux UNUSED)
+{
+  const struct lock *a = heap_entry (a_, struct lock, holder_elem);
+  const struct lock *b = heap_entry (b_, struct lock, holder_elem);
+  const struct heap_elem *a_top = heap_min (&a->donors);
+  const struct heap_elem *b_top = heap_min (&b->donors);
+
+  if (b_top == NULL)
+    return a_top != NULL;
+  if (a_top == NULL)
+    return false;
+  return donor_less (a_top, b_top, NULL);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -285,6 +607,7 @@ set_priority_for_lock_holder (struct lock *lock, int depth, int bool_depth) {
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
@@ -292,7 +615,11 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      old_level = intr_disable ();
+      lock_take (lock);
+      intr_set_level (old_level);
+    }
   return success;
 }
 
@@ -304,35 +631,22 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
-  lock_remove(lock); // 애초에 순차적으로 지우니깐 이 결과도 sorted
-  // lock release하면 현재 priority하고 만약 이게 또 다른 lock을 기다리면 그쪽에 priority 다시 갱신 필요
-  set_priority_for_lock_holder(lock, DEFAULT_DEPTH, DEFAULT_BOOL_DEPTH); // 이걸로 가능할듯 그럴려면 lock holder 아직은 초기화하면 안됨
-
-
+  // 이 lock의 waiter들이 주던 donation을 빼고 priority 다시 계산
+  old_level = intr_disable ();
+  lock_profile_released (lock);
+  heap_remove (&thread_current ()->held_locks, &lock->holder_elem);
+  thread_refresh_donation (thread_current ());
   lock->holder = NULL;
-  sema_up (&lock->semaphore);
-}
-
-/* Remove from donation list */
-void lock_remove(struct lock *l) {
-// thread_current()->donation_list 가 empty이면 안됨
-  if(list_empty(&thread_current()->donation_list)) {
-    return;
-  }
-  struct list_elem *e = list_begin (&thread_current()->donation_list);
+  intr_set_level (old_level);
 
-  while (e!=list_end(&thread_current()->donation_list)) { // current thread의 donation 리스트 순회
-    struct thread *t = list_entry (e, struct thread, donation_elem);
-    if (t->waiting_for_this_lock == l) // donation의 element가 lock을 소유했다면 리스트에서 삭제
-      list_remove(e);
-    e = list_next(e);
-  }
+  sema_up (&lock->semaphore);
 }
 
-
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
    a lock would be racy.) */
@@ -345,6 +659,295 @@ lock_held_by_current_thread (const struct lock *lock)
 }
 
 
+#ifdef LOCK_PROFILE
+/* Named locks, in the order they were named. */
+static struct list profiled_locks = LIST_INITIALIZER (profiled_locks);
+
+/* Names LOCK and starts listing its statistics in
+   lock_print_stats().  LOCK must live until shutdown, so this is
+   for static locks and locks in long-lived structures. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+  old_level = intr_disable ();
+  if (lock->stats.name[0] == '\0')
+    list_push_back (&profiled_locks, &lock->profile_elem);
+  strlcpy (lock->stats.name, name, sizeof lock->stats.name);
+  intr_set_level (old_level);
+}
+
+/* Returns the histogram bucket for a wait or hold of NS. */
+static int
+lock_hist_bucket (int64_t ns)
+{
+  int bucket = 0;
+
+  for (ns >>= 10; ns > 0 && bucket < LOCK_HIST_CNT - 1; ns >>= 1)
+    bucket++;
+  return bucket;
+}
+
+static inline int64_t
+lock_profile_now (void)
+{
+  return timer_ns ();
+}
+
+static inline void
+lock_profile_contended (struct lock *lock)
+{
+  lock->stats.contended++;
+}
+
+static inline void
+lock_profile_donated (struct lock *lock)
+{
+  lock->stats.donations++;
+}
+
+/* The current thread acquired LOCK after waiting since START. */
+static inline void
+lock_profile_waited (struct lock *lock, int64_t start)
+{
+  int64_t wait = lock->acquired_ns - start;
+
+  lock->stats.wait_ns += wait;
+  if (wait > lock->stats.wait_max_ns)
+    lock->stats.wait_max_ns = wait;
+  lock->stats.wait_hist[lock_hist_bucket (wait)]++;
+}
+
+static inline void
+lock_profile_taken (struct lock *lock)
+{
+  lock->stats.acquisitions++;
+  lock->acquired_ns = timer_ns ();
+}
+
+static inline void
+lock_profile_released (struct lock *lock)
+{
+  int64_t hold = timer_ns () - lock->acquired_ns;
+
+  lock->stats.hold_ns += hold;
+  if (hold > lock->stats.hold_max_ns)
+    lock->stats.hold_max_ns = hold;
+  lock->stats.hold_hist[lock_hist_bucket (hold)]++;
+}
+
+/* Copies the statistics of the IDX'th named lock, counting from
+   0 in the order they were named, to STATS.  Returns false if
+   there are not that many named locks. */
+bool
+lock_get_stats (int idx, struct lock_stats *stats)
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+  bool found = false;
+
+  for (e = list_begin (&profiled_locks); e != list_end (&profiled_locks);
+       e = list_next (e))
+    if (idx-- == 0)
+      {
+        *stats = list_entry (e, struct lock, profile_elem)->stats;
+        found = true;
+        break;
+      }
+  intr_set_level (old_level);
+  return found;
+}
+
+/* Orders named locks by total wait time, longest first. */
+static bool
+lock_wait_more (const struct list_elem *a, const struct list_elem *b,
+                void *aux UNUSED)
+{
+  return (list_entry (a, struct lock, profile_elem)->stats.wait_ns
+          > list_entry (b, struct lock, profile_elem)->stats.wait_ns);
+}
+
+/* Prints a table of the named locks, most waited-for first. */
+void
+lock_print_stats (void)
+{
+  enum intr_level old_level = intr_disable ();
+  struct list_elem *e;
+
+  list_sort (&profiled_locks, lock_wait_more, NULL);
+  printf ("Lock: %-15s %8s %8s %8s %12s %10s %12s %10s\n",
+          "name", "acquired", "waited", "donated",
+          "wait ns", "max", "hold ns", "max");
+  for (e = list_begin (&profiled_locks); e != list_end (&profiled_locks);
+       e = list_next (e))
+    {
+      const struct lock_stats *st
+        = &list_entry (e, struct lock, profile_elem)->stats;
+      int i;
+
+      printf ("Lock: %-15s %8u %8u %8u %12lld %10lld %12lld %10lld\n",
+              st->name, st->acquisitions, st->contended, st->donations,
+              st->wait_ns, st->wait_max_ns, st->hold_ns, st->hold_max_ns);
+      printf ("Lock: %-15s wait hist", st->name);
+      for (i = 0; i < LOCK_HIST_CNT; i++)
+        printf (" %u", st->wait_hist[i]);
+      printf ("\nLock: %-15s hold hist", st->name);
+      for (i = 0; i < LOCK_HIST_CNT; i++)
+        printf (" %u", st->hold_hist[i]);
+      printf ("\n");
+    }
+  intr_set_level (old_level);
+}
+#else /* !LOCK_PROFILE */
+/* Without LOCK_PROFILE the hooks are empty and compile away. */
+static inline int64_t lock_profile_now (void) { return 0; }
+static inline void lock_profile_contended (struct lock *lock UNUSED) {}
+static inline void lock_profile_donated (struct lock *lock UNUSED) {}
+static inline void lock_profile_waited (struct lock *lock UNUSED,
+                                        int64_t start UNUSED) {}
+static inline void lock_profile_taken (struct lock *lock UNUSED) {}
+static inline void lock_profile_released (struct lock *lock UNUSED) {}
+
+bool
+lock_get_stats (int idx UNUSED, struct lock_stats *stats UNUSED)
+{
+  return false;
+}
+
+void
+lock_print_stats (void)
+{
+}
+#endif /* LOCK_PROFILE */
+
+/* Initializes RW as unlocked. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  list_init (&rw->readers);
+  sema_init (&rw->drained, 0);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.  The current thread must not already hold an
+   rwlock for reading.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_read_acquire (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (cur->reading == NULL);
+
+  lock_acquire (&rw->lock); // writer가 있으면 여기서 기다리면서 donation
+  old_level = intr_disable ();
+  list_push_back (&rw->readers, &cur->reader_elem);
+  cur->reading = rw;
+  intr_set_level (old_level);
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading.  The
+   last reader out lets a waiting writer in. */
+void
+rwlock_read_release (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  struct thread *writer;
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (cur->reading == rw);
+
+  old_level = intr_disable ();
+  list_remove (&cur->reader_elem);
+  cur->reading = NULL;
+  thread_refresh_donation (cur); // writer가 주던 donation 회수
+  writer = rw->lock.holder;
+  if (writer != NULL && writer->draining == rw && list_empty (&rw->readers))
+    {
+      writer->draining = NULL;
+      sema_up (&rw->drained);
+    }
+  yield_to_max ();
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  Threads waiting for RW donate to the writer, and the
+   writer donates to the readers it waits for.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_write_acquire (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (cur->reading != rw);
+
+  lock_acquire (&rw->lock);
+  old_level = intr_disable ();
+  if (!list_empty (&rw->readers))
+    {
+      cur->draining = rw;
+      rwlock_donate_readers (rw);
+      sema_down (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_write_release (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_release (&rw->lock);
+}
+
+/* Returns what the writer waiting for T to stop reading donates
+   to T, or -1 if there is none. */
+static int
+rwlock_reader_donation (const struct thread *t)
+{
+  const struct thread *writer;
+
+  if (t->reading == NULL)
+    return -1;
+  writer = t->reading->lock.holder;
+  if (writer == NULL || writer->draining != t->reading)
+    return -1;
+  return donation_value (writer);
+}
+
+/* Passes the donation of RW's draining writer on to every reader
+   of RW, and through lock_donor_changed() on through any lock a
+   reader is itself waiting for. */
+static void
+rwlock_donate_readers (struct rwlock *rw)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+       e = list_next (e))
+    thread_refresh_donation (list_entry (e, struct thread, reader_elem));
+}
 
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
@@ -354,7 +957,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  wait_queue_init (&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -381,6 +984,8 @@ void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
   struct semaphore_elem waiter;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -388,11 +993,57 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  //list_push_back (&cond->waiters, &waiter.elem);
-  list_insert_ordered (&cond->waiters, &waiter.elem, compare_sema_priority, 0); 
+  waiter.node.queue = NULL;
+  old_level = intr_disable ();
+  wait_queue_push (&cond->waiters, &waiter.node, cur); // waiting thread의 priority 순서
+  cur->waiting_node = &waiter.node;
+  intr_set_level (old_level);
   lock_release (lock);
   sema_down (&waiter.semaphore);
+  cur->waiting_node = NULL;
+  lock_acquire (lock);
+}
+
+/* Like cond_wait(), but gives up waiting for COND after TICKS
+   timer ticks.  LOCK is reacquired either way.  Returns true if
+   COND was signaled, false if the time ran out first. */
+bool
+cond_timedwait (struct condition *cond, struct lock *lock, int64_t ticks)
+{
+  struct semaphore_elem waiter;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool signaled;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
+
+  sema_init (&waiter.semaphore, 0);
+  waiter.node.queue = NULL;
+  old_level = intr_disable ();
+  wait_queue_push (&cond->waiters, &waiter.node, cur);
+  cur->waiting_node = &waiter.node;
+  intr_set_level (old_level);
+  lock_release (lock);
+  signaled = sema_down_timeout (&waiter.semaphore, ticks);
+
+  /* cond_signal() pops a waiter and ups its semaphore at once, so
+     a waiter no longer queued after a timeout was signaled in the
+     meantime and may take the signal after all. */
+  old_level = intr_disable ();
+  if (!signaled)
+    {
+      if (waiter.node.queue != NULL)
+        wait_queue_remove (&waiter.node);
+      else
+        signaled = sema_try_down (&waiter.semaphore);
+    }
+  cur->waiting_node = NULL;
+  intr_set_level (old_level);
   lock_acquire (lock);
+  return signaled;
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
@@ -410,11 +1061,15 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)) {
-    list_sort(&cond->waiters, compare_sema_priority, NULL); // waiters list를 priority 순서대로 정렬
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+  enum intr_level old_level = intr_disable ();
+
+  if (!wait_queue_empty (&cond->waiters)) {
+    if (thread_mlfqs)
+      wait_queue_catch_up (&cond->waiters);
+    sema_up (&wait_node_entry (wait_queue_pop (&cond->waiters),
+                               struct semaphore_elem, node)->semaphore);
   }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -429,6 +1084,6 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!wait_queue_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
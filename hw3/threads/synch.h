@@ -3,59 +3,161 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include "threads/heap.h"
 
 #define DEFAULT_DEPTH 8
 #define DEFAULT_BOOL_DEPTH 1
 
+/* Threads waiting on a semaphore or condition variable, highest
+   priority first and first come, first served among equals.
+   Taking the next waiter is O(log n), and a waiter whose priority
+   changes while it waits (donation, aging, MLFQS) is moved to its
+   new place by thread_update_priority(). */
+struct wait_queue
+  {
+    struct heap heap;           /* Waiting wait_nodes. */
+    unsigned next_seq;          /* Arrival order of the next waiter. */
+    int epoch;                  /* MLFQS second waiters are caught up to. */
+  };
+
+/* One waiter in a wait_queue. */
+struct wait_node
+  {
+    struct heap_elem elem;      /* Element in the queue's heap. */
+    struct thread *thread;      /* Waiting thread. */
+    unsigned seq;               /* Arrival order. */
+    struct wait_queue *queue;   /* Queue it is in, or NULL. */
+  };
+
+/* Converts pointer to wait node WAIT_NODE into a pointer to the
+   structure that WAIT_NODE is embedded inside, like list_entry(). */
+#define wait_node_entry(WAIT_NODE, STRUCT, MEMBER)              \
+        ((STRUCT *) ((uint8_t *) &(WAIT_NODE)->elem             \
+                     - offsetof (STRUCT, MEMBER.elem)))
+
+void wait_queue_init (struct wait_queue *);
+bool wait_queue_empty (const struct wait_queue *);
+void wait_queue_push (struct wait_queue *, struct wait_node *,
+                      struct thread *);
+struct wait_node *wait_queue_pop (struct wait_queue *);
+void wait_queue_requeue (struct wait_queue *, struct wait_node *);
+void wait_queue_remove (struct wait_node *);
+void wait_node_update (struct wait_node *);
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct wait_queue waiters;  /* Waiting threads. */
   };
  
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's wait queue. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct wait_node node;              /* Waiter in the condition. */
     struct semaphore semaphore;         /* This semaphore. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
+/* Contention statistics of a named lock, see lock_set_name().
+   Times are in nanoseconds.  Histogram bucket I counts waits or
+   holds of less than 2**(I+10) ns, about 2**I us; the last bucket
+   also counts everything longer. */
+#define LOCK_HIST_CNT 16
+struct lock_stats
+  {
+    char name[16];              /* Name given by lock_set_name(). */
+    unsigned acquisitions;      /* # of times acquired. */
+    unsigned contended;         /* # of those that had to wait. */
+    unsigned donations;         /* # of waits that raised a holder's
+                                   priority. */
+    int64_t wait_ns;            /* Total time waited to acquire. */
+    int64_t wait_max_ns;        /* Longest wait. */
+    int64_t hold_ns;            /* Total time held. */
+    int64_t hold_max_ns;        /* Longest hold. */
+    unsigned wait_hist[LOCK_HIST_CNT];  /* Waits by length. */
+    unsigned hold_hist[LOCK_HIST_CNT];  /* Holds by length. */
+  };
+
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct heap donors;         /* Waiting threads, best donor first. */
+    struct heap_elem holder_elem; /* Element in holder's held_locks. */
+#ifdef LOCK_PROFILE
+    struct lock_stats stats;    /* Contention statistics. */
+    int64_t acquired_ns;        /* When the holder acquired it. */
+    struct list_elem profile_elem; /* Element in list of named locks. */
+#endif
   };
 
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
+bool lock_acquire_timeout (struct lock *, int64_t ticks);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Lock profiling.  Only if the kernel is built with LOCK_PROFILE
+   defined (add -DLOCK_PROFILE to CPPFLAGS); otherwise locks carry
+   no statistics, lock_set_name() does nothing and
+   lock_get_stats() finds no locks. */
+#ifdef LOCK_PROFILE
+void lock_set_name (struct lock *, const char *name);
+#else
+#define lock_set_name(LOCK, NAME) ((void) 0)
+#endif
+bool lock_get_stats (int idx, struct lock_stats *);
+void lock_print_stats (void);
+
+/* Reader-writer lock.
+
+   Any number of readers, or one writer, may hold it.  A writer
+   holds LOCK for as long as it writes, and each reader holds LOCK
+   only while it joins, so a waiting writer keeps new readers out
+   and everyone queued behind the writer donates to it through
+   LOCK.  While the writer waits for the readers already inside
+   to leave, it donates to each of them in turn.  A thread may
+   hold at most one rwlock for reading at a time. */
+struct rwlock
+  {
+    struct lock lock;           /* Writer's lock, see above. */
+    struct list readers;        /* Threads holding it for reading. */
+    struct semaphore drained;   /* Upped by the last reader out while
+                                   a writer waits. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct wait_queue waiters;  /* Waiting semaphore_elems. */
   };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_timedwait (struct condition *, struct lock *, int64_t ticks);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
 /* HW2 - priority scheduling */
-bool compare_sema_priority (const struct list_elem *, const struct list_elem *, void *);
-void set_priority_for_lock_holder (struct lock *lock, int depth, int bool_depth);
-void lock_remove(struct lock *l);
+int lock_max_donation (const struct thread *);
+void lock_donor_changed (struct thread *);
+bool lock_donation_less (const struct heap_elem *, const struct heap_elem *,
+                         void *aux);
 
 /* Optimization barrier.
 
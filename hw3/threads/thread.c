@@ -1,13 +1,18 @@
 #include "threads/thread.h"
+#include <ctype.h>
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/flags.h"
+#include "threads/heap.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/sched-trace.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -15,20 +20,61 @@
 #include "userprog/process.h"
 
 #endif 
-#include "threads/fixed_point.c"
 
 /* Random value for struct thread's `magic' member.
    Used to detect stack overflow.  See the big comment at the top
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
 
-/* List of processes in THREAD_BLOCKED state, that is, processes
-   that are sleeping. */
-static struct list blocked_list;
+   There is one FIFO list per priority level.  Bit P of
+   ready_bitmap is set exactly when ready_queue[P] is non-empty,
+   so the highest-priority ready thread is found with a single
+   bit scan instead of by keeping one list sorted. */
+#if PRI_MIN != 0 || PRI_MAX > 63
+#error ready_bitmap requires PRI_MIN == 0 and PRI_MAX <= 63
+#endif
+static struct list ready_queue[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /* # of threads in ready_queue. */
+
+/* Stride scheduler run queue, used instead of ready_queue when
+   thread_stride is true: ready threads ordered by pass, lowest
+   first.  stride_pass is the pass of the thread picked last; a
+   thread that joins the queue behind it starts from there, so
+   time spent blocked does not turn into a burst of CPU later. */
+static struct heap stride_heap;
+static int64_t stride_pass;
+
+/* Real-time run queue: ready periodic threads ordered by
+   absolute deadline, earliest first.  It is always served before
+   ready_queue (or stride_heap), so the EDF class sits above every
+   other scheduling policy.  rt_utilization is the density of all
+   admitted periodic threads, in 1/RT_UTIL_SCALE units. */
+static struct heap rt_heap;
+static int rt_utilization;
+
+/* Hierarchical timing wheel of processes in THREAD_BLOCKED state
+   that are sleeping in timer_sleep().
+
+   Level L has WHEEL_SIZE slots, each covering WHEEL_SIZE^L ticks.
+   A sleeper goes into the lowest level whose range covers its
+   distance from sleep_wheel_tick, so arming a sleep is O(1).
+   Each tick only the current level-0 slot is expired; when the
+   level-0 index wraps, the next level-1 slot is cascaded down
+   (and so on upward), which keeps expiry O(1) amortized no
+   matter how many threads are asleep.  Sleeps too far away for
+   the top level wait on sleep_overflow. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+static struct list sleep_wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static struct list sleep_overflow;
+static int64_t sleep_wheel_tick;  /* Last tick the wheel expired. */
+static size_t sleeper_cnt;        /* # of threads in the wheel. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -40,8 +86,19 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* Pages of exited threads, kept for reuse by thread_alloc() so
+   that short-lived threads do not go through palloc each time.
+   Only the struct thread part of a page is ever cleared again
+   (by init_thread()); the stack needs no zeroing.  Bounded, so
+   that a burst of exits still returns memory to palloc. */
+#define THREAD_PAGE_CACHE_CNT 16
+static void *thread_page_cache[THREAD_PAGE_CACHE_CNT];
+static int thread_page_cache_cnt;
+
+/* Live threads by tid, for thread_find().  tids are handed out
+   sequentially, so the low bits spread them evenly. */
+#define TID_HASH_CNT 64                 /* Power of 2. */
+static struct list tid_hash[TID_HASH_CNT];
 
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
@@ -57,17 +114,59 @@ static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
 /* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
+#define TIME_SLICE 4            /* Default # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* Time slice, in ticks, for each band of SLICE_BAND_SIZE
+   priorities, lowest band first.  Set with "-o slice=" through
+   thread_parse_slices() and changed at runtime with
+   thread_set_slice(). */
+#define SLICE_BAND_SIZE ((PRI_MAX - PRI_MIN + 1) / SLICE_BANDS)
+#if SLICE_BANDS != 4
+#error slice_ticks initializer assumes SLICE_BANDS == 4
+#endif
+static unsigned slice_ticks[SLICE_BANDS] =
+  { TIME_SLICE, TIME_SLICE, TIME_SLICE, TIME_SLICE };
+
 /* HW2 */
-static int load_avg;
+static fixed_t load_avg;
+
+/* MLFQS recent_cpu decay is applied lazily.  mlfqs_epoch counts
+   the once-per-second load_avg updates, and load_avg_history
+   keeps the load_avg of the last EPOCH_HISTORY of them, so a
+   thread stamped with an older cpu_epoch can replay exactly the
+   decays it missed the next time it is looked at.
+
+   Threads are also kept in epoch_bucket[cpu_epoch % EPOCH_HISTORY].
+   Each second the bucket about to fall out of the history is
+   caught up, which bounds how far behind any thread can get.
+
+   Only blocked threads are lazy.  The running and ready threads
+   are still decayed every second, since their priorities pick
+   the next thread to run, so the per-second work is O(ready
+   threads) rather than O(all threads). */
+#define EPOCH_HISTORY 64
+static int mlfqs_epoch;
+static fixed_t load_avg_history[EPOCH_HISTORY];
+static struct list epoch_bucket[EPOCH_HISTORY];
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
+
+/* If true, a thread that waits in the ready queue for
+   thread_aging_ticks ticks gets its priority raised by one, and
+   again every thread_aging_ticks after that, until it runs.
+   Controlled by kernel command-line options "-o aging" and
+   "-o aging-ticks=N". */
 bool thread_aging;
+unsigned thread_aging_ticks = AGING_TICKS_DEFAULT;
+
+/* If true, use the stride (proportional-share) scheduler: each
+   thread gets CPU time in proportion to its tickets.
+   Controlled by kernel command-line option "-o stride". */
+bool thread_stride;
 
 static void kernel_thread (thread_func *, void *aux);
 
@@ -80,13 +179,32 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (void);
+static int ready_queue_max_priority (void);
+static bool ready_queue_preempts (void);
+static bool stride_less (const struct heap_elem *, const struct heap_elem *,
+                         void *aux);
+static bool rt_less (const struct heap_elem *, const struct heap_elem *,
+                     void *aux);
+static bool rt_preempts (const struct thread *);
+static void ready_queue_age (void);
+static bool rt_next_release (struct thread *);
+static void periodic_thread (void *aux);
+static struct thread *thread_alloc (const char *name, int priority,
+                                    thread_func *, void *aux);
+static fixed_t calc_recent_cpu_at (fixed_t load_avg_, fixed_t recent_cpu, int nice);
+static void sleep_wheel_insert (struct thread *, int64_t earliest);
+static void sleep_wheel_cascade (struct list *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queues and the tid hash, where the
+   initial thread is entered under its tid.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -97,19 +215,41 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
-  list_init (&ready_list);
+  sched_trace_init ();
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init (&ready_queue[i]);
+  ready_bitmap = 0;
+  ready_cnt = 0;
+  ASSERT (!(thread_mlfqs && thread_stride));
+  heap_init (&stride_heap, stride_less, NULL);
+  stride_pass = 0;
+  heap_init (&rt_heap, rt_less, NULL);
+  rt_utilization = 0;
   list_init (&all_list);
-  list_init (&blocked_list); // initiate blocked list
+  for (i = 0; i < WHEEL_LEVELS * WHEEL_SIZE; i++)
+    list_init (&sleep_wheel[i / WHEEL_SIZE][i % WHEEL_SIZE]);
+  list_init (&sleep_overflow);
+  sleep_wheel_tick = 0;
+  sleeper_cnt = 0;
+  for (i = 0; i < EPOCH_HISTORY; i++)
+    list_init (&epoch_bucket[i]);
+  for (i = 0; i < TID_HASH_CNT; i++)
+    list_init (&tid_hash[i]);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
-  initial_thread->recent_cpu = 0; // float 0 == int 0
+  list_push_back (&tid_hash[initial_thread->tid % TID_HASH_CNT],
+                  &initial_thread->tid_elem);
+  initial_thread->run_start_tsc = rdtsc ();
+  sched_trace_name (initial_thread->tid, initial_thread->name);
+  initial_thread->recent_cpu = convert_to_fixed_point(0);
   initial_thread->nice = 0;
 
 }
@@ -148,18 +288,123 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+  if (t != idle_thread)
+    {
+      /* Only a lock donation counts: an aging boost also raises
+         priority above initial_priority but is not donated. */
+      t->stats.run_ticks++;
+      if (!thread_mlfqs
+          && lock_max_donation (t) > (thread_stride ? t->initial_tickets
+                                                    : t->initial_priority))
+        t->stats.donated_ticks++;
+    }
+
+  /* Charge a periodic thread's budget.  A job may use all of it;
+     only a job that runs past it is cut off until the next
+     release. */
+  if (t->rt_period != 0 && ++t->rt_used > t->rt_budget)
+    {
+      t->rt_throttled = true;
+      intr_yield_on_return ();
+    }
+
+  if (thread_aging && !thread_mlfqs && !thread_stride)
+    ready_queue_age ();
+
+  /* Charge the running thread one tick's worth of its stride. */
+  if (thread_stride && t != idle_thread)
+    t->pass += STRIDE_ONE / t->tickets;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  /* Enforce preemption.  The idle thread only runs with an empty
+     run queue, and tickless idle may account its ticks outside
+     interrupt context, so it is never preempted here. */
+  if (t != idle_thread && ++thread_ticks >= thread_get_slice (t->priority))
     intr_yield_on_return ();
 }
 
+/* Sets the time slice of priority band BAND to TICKS. */
+void
+thread_set_slice (int band, unsigned ticks)
+{
+  ASSERT (band >= 0 && band < SLICE_BANDS);
+  ASSERT (ticks > 0);
+
+  slice_ticks[band] = ticks;
+}
+
+/* Returns the time slice, in ticks, of a thread at PRIORITY. */
+unsigned
+thread_get_slice (int priority)
+{
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  return slice_ticks[(priority - PRI_MIN) / SLICE_BAND_SIZE];
+}
+
+/* Sets the time slices from SPEC, the value of "-o slice=":
+   either one tick count for every band, or SLICE_BANDS
+   comma-separated counts, lowest priority band first, for
+   example "16,8,4,2".  Returns false, changing nothing, if SPEC
+   is malformed. */
+bool
+thread_parse_slices (const char *spec)
+{
+  unsigned ticks[SLICE_BANDS];
+  const char *p = spec;
+  int n = 0;
+  int i;
+
+  for (;;)
+    {
+      unsigned value = 0;
+
+      if (!isdigit (*p))
+        return false;
+      while (isdigit (*p))
+        value = value * 10 + (*p++ - '0');
+      if (value == 0 || n == SLICE_BANDS)
+        return false;
+      ticks[n++] = value;
+
+      if (*p == '\0')
+        break;
+      if (*p++ != ',')
+        return false;
+    }
+  if (n != 1 && n != SLICE_BANDS)
+    return false;
+
+  for (i = 0; i < SLICE_BANDS; i++)
+    thread_set_slice (i, ticks[n == 1 ? 0 : i]);
+  return true;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
 {
+  struct list_elem *e;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      const struct thread_stats *st = &t->stats;
+
+      printf ("Thread %d %s: %lld run ticks, %llu cycles, %lld ready ticks, "
+              "%lld sleep ticks, %lld donated ticks, "
+              "%u voluntary and %u involuntary switches\n",
+              t->tid, t->name, st->run_ticks, st->run_cycles, st->ready_ticks,
+              st->sleep_ticks, st->donated_ticks,
+              st->voluntary_switches, st->involuntary_switches);
+      if (t->rt_period != 0)
+        printf ("Thread %s: %u deadline misses in %u periods\n",
+                t->name, t->rt_misses, t->rt_jobs);
+    }
+  sched_trace_dump ();
+  lock_print_stats ();
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -180,24 +425,203 @@ thread_print_stats (void)
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
+{
+  struct thread *t;
+  tid_t tid;
+
+  t = thread_alloc (name, priority, function, aux);
+  if (t == NULL)
+    return TID_ERROR;
+  tid = t->tid;
+
+  /* Add to run queue.  From here on T may run, exit and have its
+     page reused at any time, so it is not touched again. */
+  thread_unblock (t);
+
+  yield_to_max (); // 새로 생성된 스레드 t가 current thread보다 priority가 높으면 cpu 양보
+
+  return tid;
+}
+
+/* Creates a real-time kernel thread named NAME that calls
+   FUNCTION, passing AUX, once every PERIOD timer ticks, starting
+   now.  Each call may use up to BUDGET ticks of CPU time and
+   should finish within DEADLINE ticks of its release, so
+   0 < BUDGET <= DEADLINE <= PERIOD.
+
+   Periodic threads are scheduled earliest-deadline-first ahead
+   of all other threads.  A job that runs past its budget is
+   stopped until the next release and then carried over: it
+   finishes on the next period's budget, and its successor is
+   released as soon as it does, in what is left of that period.
+   Every job is counted once in rt_jobs, and once in rt_misses
+   if it finishes after its own deadline.
+   Returns the new thread's tid, or TID_ERROR if the parameters
+   are invalid, if admitting the thread would push the EDF class
+   over RT_UTIL_MAX, or if creation fails. */
+tid_t
+thread_create_periodic (const char *name, int64_t period, int64_t budget,
+                        int64_t deadline, thread_func *function, void *aux)
+{
+  struct thread *t;
+  enum intr_level old_level;
+  int density;
+  tid_t tid;
+
+  ASSERT (function != NULL);
+
+  if (budget <= 0 || budget > deadline || deadline > period)
+    return TID_ERROR;
+  density = DIV_ROUND_UP (budget * RT_UTIL_SCALE, deadline);
+
+  /* Admission control. */
+  old_level = intr_disable ();
+  if (rt_utilization + density > RT_UTIL_MAX)
+    {
+      intr_set_level (old_level);
+      return TID_ERROR;
+    }
+  rt_utilization += density;
+  intr_set_level (old_level);
+
+  t = thread_alloc (name, PRI_MAX, periodic_thread, NULL);
+  if (t == NULL)
+    {
+      old_level = intr_disable ();
+      rt_utilization -= density;
+      intr_set_level (old_level);
+      return TID_ERROR;
+    }
+  t->rt_period = period;
+  t->rt_budget = budget;
+  t->rt_rel_deadline = deadline;
+  t->rt_release = timer_ticks ();
+  t->rt_deadline = t->rt_release + deadline;
+  t->rt_job_deadline = t->rt_deadline;
+  t->rt_jobs = 1;
+  t->rt_func = function;
+  t->rt_aux = aux;
+  tid = t->tid;
+
+  thread_unblock (t);
+  yield_to_max ();
+
+  return tid;
+}
+
+/* Ends the current periodic thread's job and sleeps until its
+   next release.  Called by periodic_thread() after each job.
+   If the job was carried over from the previous period, the next
+   job starts at once on the budget that is left, if any. */
+void
+thread_wait_next_period (void)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool wait = false;
+
+  ASSERT (cur->rt_period != 0);
+
+  old_level = intr_disable ();
+  if (timer_ticks () > cur->rt_job_deadline)
+    cur->rt_misses++;
+  cur->rt_jobs++;
+  cur->rt_throttled = false;
+
+  /* A carried-over job already used up this period's release, so
+     its successor runs in the same period instead of skipping it. */
+  if (!cur->rt_carried || cur->rt_used >= cur->rt_budget)
+    wait = rt_next_release (cur);
+  cur->rt_carried = false;
+  cur->rt_job_deadline = cur->rt_deadline;
+  if (wait)
+    thread_yield_sleep (cur->rt_release);
+  intr_set_level (old_level);
+}
+
+/* Copies the statistics of the thread with tid TID into *STATS.
+   Returns false if there is no such thread. */
+bool
+thread_get_stats (tid_t tid, struct thread_stats *stats)
+{
+  struct thread *t;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  t = thread_find (tid);
+  if (t != NULL)
+    {
+      *stats = t->stats;
+      if (t->status == THREAD_RUNNING)
+        stats->run_cycles += rdtsc () - t->run_start_tsc;
+    }
+  intr_set_level (old_level);
+  return t != NULL;
+}
+
+/* Returns the live thread with tid TID, or a null pointer if
+   there is none.  Unless the caller keeps interrupts off, it
+   must know by other means that the thread cannot exit and be
+   freed while it uses the result, for example by being its
+   parent process, which the child waits for before exiting. */
+struct thread *
+thread_find (tid_t tid)
+{
+  struct list *bucket = &tid_hash[(unsigned) tid % TID_HASH_CNT];
+  struct thread *found = NULL;
+  struct list_elem *e;
+  enum intr_level old_level;
+
+  if (tid <= 0)
+    return NULL;
+
+  old_level = intr_disable ();
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, tid_elem);
+      if (t->tid == tid)
+        {
+          found = t;
+          break;
+        }
+    }
+  intr_set_level (old_level);
+  return found;
+}
+
+/* Allocates and initializes a thread named NAME with the given
+   PRIORITY that will execute FUNCTION passing AUX, and leaves it
+   blocked.  Returns the new thread, or a null pointer if
+   allocation fails. */
+static struct thread *
+thread_alloc (const char *name, int priority,
+              thread_func *function, void *aux)
 {
   struct thread *t;
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
-  tid_t tid;
   enum intr_level old_level;
 
   ASSERT (function != NULL);
 
-  /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  /* Allocate thread, from the page cache if possible. */
+  old_level = intr_disable ();
+  t = thread_page_cache_cnt > 0
+      ? thread_page_cache[--thread_page_cache_cnt] : NULL;
+  intr_set_level (old_level);
   if (t == NULL)
-    return TID_ERROR;
+    t = palloc_get_page (0);
+  if (t == NULL)
+    return NULL;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
-  tid = t->tid = allocate_tid ();
+  t->tid = allocate_tid ();
+  sched_trace_name (t->tid, t->name);
+  old_level = intr_disable ();
+  list_push_back (&tid_hash[t->tid % TID_HASH_CNT], &t->tid_elem);
+  intr_set_level (old_level);
 
   // Initialize fd_table
   /*
@@ -230,13 +654,7 @@ thread_create (const char *name, int priority,
 
   intr_set_level (old_level);
 
-  /* Add to run queue. */
-  thread_unblock (t);
-
-  if (t->priority > thread_get_priority())
-    thread_yield(); // 새로 생성된 스레드 t가 current thread보다 priority가 높으면 cpu 양보
-
-  return tid;
+  return t;
 }
 
 /* 스레드들의 priority를 비교하는 함수. priority of a > b이면 true 반환 */
@@ -245,9 +663,6 @@ bool compare_thread_priority (const struct list_elem *a, const struct list_elem
   return list_entry (a, struct thread, elem)->priority > list_entry (b, struct thread, elem)->priority;
 }
 
-bool compare_donation_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) {
-return list_entry (a, struct thread, donation_elem)->priority > list_entry (b, struct thread, donation_elem)->priority;
-} 
 
 
 
@@ -264,9 +679,37 @@ thread_block (void)
   ASSERT (intr_get_level () == INTR_OFF);
 
   thread_current ()->status = THREAD_BLOCKED;
+  sched_trace_record (TRACE_BLOCK, thread_current (), 0);
   schedule ();
 }
 
+/* Like thread_block(), but also wakes the current thread at timer
+   tick WAKE_TICK if nothing unblocks it before then.  NODE is the
+   wait-queue node the thread waits in; a timeout takes it out of
+   its queue before the thread runs, so whichever of the two wakes
+   the thread first also cancels the other.  Returns true if the
+   timeout did.
+
+   This function must be called with interrupts turned off. */
+bool
+thread_block_timeout (struct wait_node *node, int64_t wake_tick)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (cur != idle_thread);
+
+  cur->wake_tick = wake_tick;
+  cur->sleep_tick = timer_ticks ();
+  cur->timed_node = node;
+  cur->timed_out = false;
+  sleep_wheel_insert (cur, sleep_wheel_tick + 1);
+  sleeper_cnt++;
+  thread_block ();
+  return cur->timed_out;
+}
+
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -284,10 +727,17 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  //list_push_back (&ready_list, &t->elem);
-  
-  list_insert_ordered (&ready_list, &t->elem, compare_thread_priority, 0); // priority 순으로 ready list에 삽입
+  if (t->timed_node != NULL)
+    {
+      /* Woken before its timeout: leave the sleep wheel. */
+      list_remove (&t->elem);
+      sleeper_cnt--;
+      t->timed_node = NULL;
+    }
+  thread_mlfqs_catch_up (t); // 자는 동안 밀린 recent_cpu decay 반영
+  ready_queue_push (t);
   t->status = THREAD_READY;
+  sched_trace_record (TRACE_UNBLOCK, t, running_thread ()->tid);
   intr_set_level (old_level);
 }
 
@@ -339,7 +789,13 @@ thread_exit (void)
      when it calls thread_schedule_tail(). */
   intr_disable ();
   list_remove (&thread_current()->allelem);
+  list_remove (&thread_current()->tid_elem);
+  list_remove (&thread_current()->epoch_elem);
+  if (thread_current ()->rt_period != 0)
+    rt_utilization -= DIV_ROUND_UP (thread_current ()->rt_budget * RT_UTIL_SCALE,
+                                    thread_current ()->rt_rel_deadline);
   thread_current ()->status = THREAD_DYING;
+  sched_trace_record (TRACE_EXIT, thread_current (), 0);
   printf("schedule---\n");
   schedule ();
   NOT_REACHED ();
@@ -357,10 +813,29 @@ thread_yield (void)
 
   old_level = intr_disable ();
 
+  /* A periodic thread out of budget sits out the rest of its
+     period in the sleep wheel instead of the run queue.  The job
+     is not over, so it is neither counted nor judged here;
+     thread_wait_next_period() does that when it finishes. */
+  if (cur->rt_throttled)
+    {
+      cur->rt_throttled = false;
+      cur->rt_carried = true;
+      if (rt_next_release (cur))
+        {
+          cur->wake_tick = cur->rt_release;
+          cur->sleep_tick = timer_ticks ();
+          cur->status = THREAD_BLOCKED;
+          sleep_wheel_insert (cur, sleep_wheel_tick + 1);
+          sleeper_cnt++;
+          schedule ();
+          intr_set_level (old_level);
+          return;
+        }
+    }
 
   if (cur != idle_thread) 
-    //list_push_back (&ready_list, &cur->elem);
-    list_insert_ordered (&ready_list, &cur->elem, compare_thread_priority, 0);  // priority 순으로 ready list에 삽입
+    ready_queue_push (cur);
   cur->status = THREAD_READY;
 
 
@@ -368,15 +843,6 @@ thread_yield (void)
   intr_set_level (old_level);
 }
 
-/* faster wake_tick is true for the sorting */
-bool
-wake_time_compare(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) {
-  const struct thread *a_th = list_entry(a, struct thread, elem);
-  const struct thread *b_th = list_entry(b, struct thread, elem);
-  // Compare ticks to sort the blocked_list
-  return a_th->wake_tick < b_th->wake_tick;
-}
-
 /* Yields the CPU.  The current thread is put to sleep. */
 void
 thread_yield_sleep (int64_t wake_tick_value) 
@@ -392,35 +858,127 @@ thread_yield_sleep (int64_t wake_tick_value)
 
   if (cur != idle_thread) {
     cur->wake_tick = wake_tick_value; // Set current thread's wake_tick to wake_tick_value
+    cur->sleep_tick = timer_ticks ();
     cur->status = THREAD_BLOCKED; // Block current thread
-    list_insert_ordered(&blocked_list, &cur->elem, wake_time_compare, NULL);
-    // Insert current thread to blocked_list, shortest wake_tick fisrt
+    sleep_wheel_insert (cur, sleep_wheel_tick + 1); // Arm current thread's slot in the timing wheel
+    sleeper_cnt++;
     schedule();
   }
  
   intr_set_level (old_level);
 }
 
-/* Wake the thread when it is the right time. It should be called every tick to check */
+/* Wake the threads whose wake_tick has come.  Called every tick
+   from the timer interrupt with the current TICK. */
 void
 wake_blocked_thread(int64_t tick) {
-  
-  if (list_empty(&blocked_list)) {
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (sleeper_cnt == 0) { // Nothing to expire, just catch the wheel up
+    if (sleep_wheel_tick < tick)
+      sleep_wheel_tick = tick;
     return;
   }
 
-  struct list_elem *wake_turn;
-  struct thread *cur;
-  wake_turn = list_begin(&blocked_list);
-  cur = list_entry(wake_turn, struct thread, elem);
-  
-  while (cur->wake_tick <= tick) { // After current thread's wake_tick
-    wake_turn = list_remove(&cur->elem); // Remove current thread from blocked_list
-    thread_unblock(cur); // Unblock current thread
-    if (list_empty(&blocked_list))
-       return;
-    cur = list_entry(wake_turn, struct thread, elem); // Move to the next thread
+  while (sleep_wheel_tick < tick) {
+    struct list *slot;
+
+    sleep_wheel_tick++;
+
+    /* Cascade the higher levels whose index wrapped, top first,
+       so that every sleeper lands in level 0 by its wake tick. */
+    if ((sleep_wheel_tick & ((1LL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)) == 0)
+      sleep_wheel_cascade (&sleep_overflow);
+    for (level = WHEEL_LEVELS - 1; level > 0; level--) {
+      if ((sleep_wheel_tick & ((1LL << (WHEEL_BITS * level)) - 1)) == 0)
+        sleep_wheel_cascade (&sleep_wheel[level][(sleep_wheel_tick >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+    }
+
+    slot = &sleep_wheel[0][sleep_wheel_tick & WHEEL_MASK];
+    while (!list_empty (slot)) {
+      struct thread *t = list_entry (list_pop_front (slot), struct thread, elem);
+      sleeper_cnt--;
+      if (t->timed_node != NULL) { // timed wait가 timeout: wait queue에서 빼기
+        wait_queue_remove (t->timed_node);
+        t->timed_node = NULL;
+        t->timed_out = true;
+      }
+      else
+        t->stats.sleep_ticks += sleep_wheel_tick - t->sleep_tick;
+      sched_trace_record (TRACE_WAKE, t, 0);
+      thread_unblock (t); // Unblock the expired thread
+    }
+  }
+
+  if (intr_context ())
+    yield_to_max (); // 깨어난 thread가 더 급하면 interrupt return 시 바로 실행
+}
+
+/* Returns how many ticks after the last expired tick the sleep
+   queue next needs the timer: the next non-empty level-0 slot or
+   the next cascade, whichever is first, but at most LIMIT. */
+int64_t
+ticks_until_wake (int64_t limit)
+{
+  int64_t d;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (sleeper_cnt == 0)
+    return limit;
+  for (d = 1; d < limit; d++) {
+    int64_t tick = sleep_wheel_tick + d;
+    if ((tick & WHEEL_MASK) == 0 || !list_empty (&sleep_wheel[0][tick & WHEEL_MASK]))
+      return d;
   }
+  return limit;
+}
+
+/* Puts sleeping thread T into the wheel slot for its wake_tick,
+   relative to sleep_wheel_tick, but no earlier than EARLIEST.
+
+   A new sleep passes sleep_wheel_tick + 1: sleep_wheel_tick's own
+   slot has already been expired, so a sleep that is already due,
+   as in timer_sleep(0) or when a tick lands between reading
+   timer_ticks() and getting here, waits for the next tick instead
+   of a full turn of level 0.  A cascade runs before the current
+   slot is expired, so it passes sleep_wheel_tick itself. */
+static void
+sleep_wheel_insert (struct thread *t, int64_t earliest)
+{
+  int64_t expires = t->wake_tick;
+  int64_t delta;
+  int level;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (expires < earliest)
+    expires = earliest;
+  delta = expires - sleep_wheel_tick;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    if (delta < (1LL << (WHEEL_BITS * (level + 1)))) {
+      list_push_back (&sleep_wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK], &t->elem);
+      return;
+    }
+  list_push_back (&sleep_overflow, &t->elem);
+}
+
+/* Re-inserts every sleeper in SLOT relative to the current
+   sleep_wheel_tick, moving each one down a level or more. */
+static void
+sleep_wheel_cascade (struct list *slot)
+{
+  struct list pending;
+
+  list_init (&pending);
+  while (!list_empty (slot))
+    list_push_back (&pending, list_pop_front (slot));
+  while (!list_empty (&pending))
+    sleep_wheel_insert (list_entry (list_pop_front (&pending), struct thread, elem),
+                        sleep_wheel_tick);
 }
 
 /* Invoke function 'func' on all threads, passing along 'aux'.
@@ -440,27 +998,60 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* ready list에서 priority가 가장 높은 thread와 current thread를 비교. ready list의 thread가 priority 높으면 cpu 양보 */
+/* ready queue에서 priority가 가장 높은 thread와 current thread를 비교. ready queue의 thread가 priority 높으면 cpu 양보.
+   Called from an interrupt handler, the yield happens as the
+   handler returns instead, so a wakeup from an interrupt runs the
+   woken thread at once rather than at the end of a time slice. */
 void
 yield_to_max (void) {
+  enum intr_level old_level = intr_disable ();
 
-  //struct thread *first;
-  //first = list_entry (list_front (&ready_list), struct thread, elem);
-
-  //if (list_empty(&ready_list))
-  //  return;
-
-  if (!list_empty(&ready_list) && thread_current ()->priority < list_entry (list_front (&ready_list), struct thread, elem)->priority) {
-    thread_yield ();
+  if (ready_queue_preempts ()) {
+    if (intr_context ()) {
+      if (thread_current () == idle_thread)
+        timer_idle_exit (); // tickless one-shot을 끄고 밀린 tick을 idle에 반영
+      intr_yield_on_return ();
+    }
+    else
+      thread_yield ();
   }
+  intr_set_level (old_level);
 }
 
-/* ready list sorting */
-void ready_list_sort(void) {
-  if(list_empty(&ready_list)) {
-    return;
-  }
-  list_sort(&ready_list, compare_thread_priority, NULL);
+/* Sets T's effective priority to PRIORITY.  If T is in the run
+   queue it is moved to the list for its new priority, and if it
+   waits on a semaphore or condition it is moved within that wait
+   queue, so a donation never needs a whole queue re-sorted.  If T
+   waits for a lock, the change is passed on to the lock's holder
+   by lock_donor_changed(). */
+void
+thread_update_priority (struct thread *t, int priority)
+{
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  old_level = intr_disable ();
+  t->aging_base = -1;
+  if (t->priority == priority)
+    {
+      intr_set_level (old_level);
+      return;
+    }
+  if (t->status == THREAD_READY)
+    {
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_push (t);
+    }
+  else
+    t->priority = priority;
+  wait_node_update (&t->sema_node);
+  if (t->waiting_node != NULL)
+    wait_node_update (t->waiting_node);
+  lock_donor_changed (t);
+  intr_set_level (old_level);
 }
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
@@ -475,26 +1066,64 @@ thread_set_priority (int new_priority)
   yield_to_max(); // priority 변경이 일어났는지 체크하고, 변경이 일어났다면 yield
 }
 
-void change_priority(void) {
-  struct thread *t = thread_current();
-  t->priority = t->initial_priority;
+/* Sets the current thread's base ticket count to NEW_TICKETS,
+   for the stride scheduler. */
+void
+thread_set_tickets (int new_tickets)
+{
+  enum intr_level old_level;
 
-  if (!list_empty(&t->donation_list)) {
-    list_sort(&t->donation_list, compare_donation_priority, NULL); // sorting 필요?? 필요하다면 donation element들을 비교하는 함수를 추가 구현해야 하는지 아니면 compare thread priority 함수로 sorting 할 수 있는지 확인필요
-    struct thread *first = list_entry(list_front(&t->donation_list), struct thread, donation_elem);
-    if (first->priority > t->priority) { // donation 리스트에서 가장 priority가 높은 thread와 현재 thread 비교. 높은 값을 현재 thread의 priority로 설정
-      t->priority = first->priority;
-      ready_list_sort();
-    }
-    if(t->waiting_for_this_lock != NULL) {
-      set_priority_for_lock_holder(t->waiting_for_this_lock, DEFAULT_DEPTH - 1, DEFAULT_BOOL_DEPTH);
+  ASSERT (new_tickets >= 1 && new_tickets <= STRIDE_TICKETS_MAX);
+
+  old_level = intr_disable ();
+  thread_current ()->initial_tickets = new_tickets;
+  thread_refresh_donation (thread_current ());
+  intr_set_level (old_level);
+}
+
+/* Returns the current thread's ticket count, donations included. */
+int
+thread_get_tickets (void)
+{
+  return thread_current ()->tickets;
+}
+
+/* Recomputes T's effective priority, or its tickets under the
+   stride scheduler, as the larger of its own and the best one
+   donated by a waiter of a lock T holds.  O(1): the donations
+   are kept in heaps, see synch.c.  Does nothing under the MLFQS,
+   which has no donation, as thread_set_priority() does. */
+void
+thread_refresh_donation (struct thread *t)
+{
+  enum intr_level old_level;
+  int donated;
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  donated = lock_max_donation (t);
+  if (thread_stride)
+    {
+      int tickets = donated > t->initial_tickets ? donated : t->initial_tickets;
+      if (t->tickets != tickets)
+        {
+          t->tickets = tickets;
+          lock_donor_changed (t);
+        }
     }
-  }
+  thread_update_priority (t, !thread_stride && donated > t->initial_priority
+                             ? donated : t->initial_priority);
+  intr_set_level (old_level);
+}
+
+void change_priority(void) {
+  thread_refresh_donation (thread_current ());
 }
 
-int calc_priority(int recent_cpu, int nice) {
-  int result = substract_fixed_and_fixed(substract_fixed_and_fixed(convert_to_fixed_point(PRI_MAX), divide_fixed_and_int(recent_cpu, 4)), multiply_fixed_and_int(convert_to_fixed_point(nice), 2));
-  result = convert_to_int_to_nearest(result);
+int calc_priority(fixed_t recent_cpu, int nice) {
+  int result = convert_to_int_to_nearest(substract_fixed_and_fixed(substract_fixed_and_fixed(convert_to_fixed_point(PRI_MAX), divide_fixed_and_int(recent_cpu, 4)), multiply_fixed_and_int(convert_to_fixed_point(nice), 2)));
   if (result > PRI_MAX) {
     result = PRI_MAX;
   }
@@ -550,6 +1179,7 @@ int
 thread_get_recent_cpu (void) 
 {
   enum intr_level before = intr_disable(); 
+  thread_mlfqs_catch_up (thread_current ());
   // return convert_to_int_to_nearest(multiply_fixed_and_int(thread_current()->recent_cpu, 100));
   int result = convert_to_int_to_nearest(multiply_fixed_and_int(thread_current()->recent_cpu, 100)); 
   intr_set_level(before);
@@ -557,33 +1187,21 @@ thread_get_recent_cpu (void)
 
 }
 
+/* Recomputes the running thread's priority, every 4 ticks.
+   Between the once-per-second updates only the running thread's
+   recent_cpu changes, so every other thread's priority is still
+   what calc_priority() would give. */
 void
 set_priority(void) {
-  int max_priority = -1;
-  struct thread *t;
-  struct thread *r;
-  struct list_elem *e;
-  if(REFRESH_TOTAL_PRIORITY ) {
-    for (e=list_begin(&all_list); e!=list_end(&all_list); e=list_next(e)) {
-        t = list_entry (e, struct thread, allelem);
-        t->priority = calc_priority(t->recent_cpu,t->nice);
-    }
-  
-    if (!list_empty(&ready_list)) {
-        r = list_entry(list_front(&ready_list), struct thread, elem);
-        max_priority = r->priority;
-    }
-  
-    if (thread_current()->priority < max_priority)
-      intr_yield_on_return();
-  }
-  else {
-    t = thread_current();
-    if (t == idle_thread) { 
-        return;
-      }
-    t->priority = calc_priority (t->recent_cpu, t->nice);
+  struct thread *t = thread_current();
+
+  if (t == idle_thread) { 
+    return;
   }
+  t->priority = calc_priority (t->recent_cpu, t->nice);
+
+  if (t->priority < ready_queue_max_priority ())
+    intr_yield_on_return();
 }
 
 
@@ -601,75 +1219,113 @@ int count_ready_threads() {
     }
   }
   */
-  result = result + list_size(&ready_list);
+  result = result + ready_cnt;
   if (thread_current() != idle_thread) {
     result = result + 1;
   }
   return result;
 }
 
-int calc_load_avg() {
+fixed_t calc_load_avg() {
   return add_fixed_and_fixed(divide_fixed_and_int(multiply_fixed_and_int(load_avg, 59), 60), divide_fixed_and_int(convert_to_fixed_point(count_ready_threads()), 60));
 }
 
-int calc_recent_cpu(int recent_cpu, int nice) {
-  return add_fixed_and_int(multiply_fixed_and_fixed(divide_fixed_and_fixed(multiply_fixed_and_int(load_avg, 2), add_fixed_and_int(multiply_fixed_and_int(load_avg, 2), 1)), recent_cpu), nice);
+fixed_t calc_recent_cpu(fixed_t recent_cpu, int nice) {
+  return calc_recent_cpu_at(load_avg, recent_cpu, nice);
+}
+
+/* calc_recent_cpu() for a past second whose load_avg was LOAD_AVG_. */
+static fixed_t
+calc_recent_cpu_at (fixed_t load_avg_, fixed_t recent_cpu, int nice) {
+  return add_fixed_and_int(multiply_fixed_and_fixed(divide_fixed_and_fixed(multiply_fixed_and_int(load_avg_, 2), add_fixed_and_int(multiply_fixed_and_int(load_avg_, 2), 1)), recent_cpu), nice);
+}
+
+/* Applies to T the once-per-second recent_cpu decays it missed
+   since it was last looked at, in order and with each second's
+   own load_avg, so the result is exactly what updating T every
+   second would have produced.  Its priority follows. */
+void
+thread_mlfqs_catch_up (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!thread_mlfqs || t == idle_thread || t->cpu_epoch == mlfqs_epoch)
+    return;
+  ASSERT (mlfqs_epoch - t->cpu_epoch <= EPOCH_HISTORY);
+
+  while (t->cpu_epoch != mlfqs_epoch) {
+    t->cpu_epoch++;
+    t->recent_cpu = calc_recent_cpu_at(load_avg_history[t->cpu_epoch % EPOCH_HISTORY], t->recent_cpu, t->nice);
+  }
+  list_remove (&t->epoch_elem);
+  list_push_back (&epoch_bucket[mlfqs_epoch % EPOCH_HISTORY], &t->epoch_elem);
+  thread_update_priority (t, calc_priority(t->recent_cpu, t->nice));
+}
+
+/* Returns the number of once-per-second MLFQS updates so far.
+   A thread whose cpu_epoch matches it is up to date. */
+int
+thread_mlfqs_epoch (void)
+{
+  return mlfqs_epoch;
 }
 
+/* Once-per-second MLFQS update.  Only the running thread and the
+   ready threads, whose priorities decide what runs next, are
+   updated now, in time linear in the number of ready threads;
+   blocked threads catch up in thread_mlfqs_catch_up() when they
+   are woken or examined, or when their epoch bucket is about to
+   be reused. */
 void refresh_all_load_avg_recent_cpu_priority(int bool_refresh) {
+  struct list stale;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
   load_avg = calc_load_avg();
-  //enum intr_level before = intr_disable();
-  if(!list_empty(&all_list)) {
-    struct list_elem *e = list_begin (&all_list);
-    while (e!=list_end(&all_list)) { // current thread의 donation 리스트 순회
-      struct thread *t = list_entry (e, struct thread, allelem);
-      if (t == idle_thread) {
-        continue;
-      }
-      t->recent_cpu = calc_recent_cpu(t->recent_cpu, t->nice);
-      if(bool_refresh) {
-        t->priority = calc_priority(t->recent_cpu, t->nice);
-      }
-      e = list_next(e);
+  mlfqs_epoch++;
+  load_avg_history[mlfqs_epoch % EPOCH_HISTORY] = load_avg;
+
+  /* Threads untouched for EPOCH_HISTORY seconds must catch up
+     before their oldest second is overwritten. */
+  list_init (&stale);
+  while (!list_empty (&epoch_bucket[mlfqs_epoch % EPOCH_HISTORY]))
+    list_push_back (&stale, list_pop_front (&epoch_bucket[mlfqs_epoch % EPOCH_HISTORY]));
+  while (!list_empty (&stale)) {
+    struct thread *t = list_entry (list_pop_front (&stale), struct thread, epoch_elem);
+    list_push_back (&epoch_bucket[mlfqs_epoch % EPOCH_HISTORY], &t->epoch_elem);
+    thread_mlfqs_catch_up (t);
+  }
+
+  if (!bool_refresh)
+    return;
+  thread_mlfqs_catch_up (thread_current ());
+  for (i = PRI_MAX; i >= PRI_MIN; i--) {
+    struct list_elem *e = list_begin (&ready_queue[i]);
+    while (e != list_end (&ready_queue[i])) { // priority가 바뀌면 다른 queue로 옮겨지니 next를 먼저 저장
+      struct list_elem *next = list_next (e);
+      thread_mlfqs_catch_up (list_entry (e, struct thread, elem));
+      e = next;
     }
   }
-  //intr_set_level(before);
 }
 
 void recent_cpu_increase() {
   if(thread_current() != idle_thread) {
-    thread_current()->recent_cpu += add_fixed_and_int(thread_current()->recent_cpu, 1);
+    thread_current()->recent_cpu = add_fixed_and_int(thread_current()->recent_cpu, 1);
   }
 }
 
 void
 update_load_avg (void)
 {
-  int ready_threads = list_size(&ready_list); // ready threads 개수
+  int ready_threads = ready_cnt; // ready threads 개수
 
   if (thread_current() != idle_thread) // running 상태
     ready_threads += 1;
 
   load_avg = divide_fixed_and_int(add_fixed_and_int(multiply_fixed_and_int(load_avg, 59), ready_threads), 60); // 최근 1분 동안 수행 가능한 프로세스의 평균 개수 = load_avg = (59/60) * load_avg + (1/60) * ready_threads
 }
-
-void
-update_recent_cpu (void)
-{
-  if (thread_current() == idle_thread)
-    return;
-
-  struct thread *t;
-  struct list_elem *e;
-  
-  for (e=list_begin(&all_list); e!=list_end(&all_list); e=list_next(e)) {
-    t = list_entry (e, struct thread, allelem);
-    if (t != idle_thread) {
-      t->recent_cpu = add_fixed_and_int(multiply_fixed_and_fixed(divide_fixed_and_fixed((multiply_fixed_and_int(load_avg, 2)), (add_fixed_and_int(multiply_fixed_and_int(load_avg, 2), 1))), t->recent_cpu), t->nice);  // recent cpu = (2 * load_avg) / (2 * load_avg + 1) * recent_cpu + nice
-
-}
-}
-}
 /* Idle thread.  Executes when no other thread is ready to run.
 
    The idle thread is initially put on the ready list by
@@ -690,8 +1346,13 @@ idle (void *idle_started_ UNUSED)
     {
       /* Let someone else run. */
       intr_disable ();
+      timer_idle_exit ();
       thread_block ();
 
+      /* Nothing is runnable, so in tickless mode the timer need
+         not interrupt before the next sleeper is due. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -745,7 +1406,7 @@ is_thread (struct thread *t)
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
-  int i;
+  enum intr_level old_level;
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
@@ -760,11 +1421,17 @@ init_thread (struct thread *t, const char *name, int priority)
 
   /* HW2 */
   t->initial_priority = priority;
-  list_init(&t->donation_list); 
+  t->aging_base = -1;
+  t->tickets = t->initial_tickets = STRIDE_TICKETS_DEFAULT;
+  heap_init (&t->held_locks, lock_donation_less, NULL);
   t->waiting_for_this_lock =NULL;
 
   t->recent_cpu = running_thread()->recent_cpu; // 현재 실행되고 있는 thread에서 children 생성
   t->nice = running_thread()->nice;
+  t->cpu_epoch = mlfqs_epoch;
+  old_level = intr_disable ();
+  list_push_back (&epoch_bucket[mlfqs_epoch % EPOCH_HISTORY], &t->epoch_elem);
+  intr_set_level (old_level);
 
 #ifdef USERPROG
   t->parent = running_thread();
@@ -774,9 +1441,6 @@ init_thread (struct thread *t, const char *name, int priority)
   list_init(&(t->child));
   list_push_back(&(running_thread()->child), &(t->child_e));
 #endif
-  for (i = 0; i < 128; i++) {                                                         
-      t->fd_table[i] = NULL;                                                                
-  } 
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -800,10 +1464,258 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  if (ready_cnt == 0)
     return idle_thread;
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return ready_queue_pop ();
+}
+
+/* Returns the index of the most significant set bit in BITS,
+   which must be nonzero. */
+static inline int
+highest_set_bit (uint64_t bits)
+{
+  uint32_t hi = bits >> 32;
+  uint32_t lo = bits;
+  uint32_t idx;
+
+  ASSERT (bits != 0);
+  if (hi != 0)
+    {
+      asm ("bsrl %1, %0" : "=r" (idx) : "rm" (hi));
+      return idx + 32;
+    }
+  asm ("bsrl %1, %0" : "=r" (idx) : "rm" (lo));
+  return idx;
+}
+
+/* Appends T to the run queue list for its priority.  Threads of
+   equal priority are therefore scheduled round-robin. */
+static void
+ready_queue_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->ready_tick = timer_ticks ();
+  if (t->rt_period != 0)
+    {
+      heap_insert (&rt_heap, &t->rt_elem);
+      ready_cnt++;
+      return;
+    }
+  if (thread_stride)
+    {
+      if (t->pass < stride_pass)
+        t->pass = stride_pass;
+      heap_insert (&stride_heap, &t->stride_elem);
+      ready_cnt++;
+      return;
+    }
+  list_push_back (&ready_queue[t->priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes T, which must be in the run queue at its current
+   priority, from the run queue. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  t->stats.ready_ticks += timer_ticks () - t->ready_tick;
+  if (t->rt_period != 0)
+    {
+      heap_remove (&rt_heap, &t->rt_elem);
+      ready_cnt--;
+      return;
+    }
+  if (thread_stride)
+    {
+      heap_remove (&stride_heap, &t->stride_elem);
+      ready_cnt--;
+      return;
+    }
+  list_remove (&t->elem);
+  if (list_empty (&ready_queue[t->priority]))
+    ready_bitmap &= ~((uint64_t) 1 << t->priority);
+  ready_cnt--;
+}
+
+/* Removes and returns the first thread of the highest-priority
+   non-empty run queue list.  The run queue must not be empty. */
+static struct thread *
+ready_queue_pop (void)
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (ready_cnt > 0);
+
+  if (!heap_empty (&rt_heap))
+    {
+      t = heap_entry (heap_min (&rt_heap), struct thread, rt_elem);
+      ready_queue_remove (t);
+      return t;
+    }
+  if (thread_stride)
+    {
+      t = heap_entry (heap_min (&stride_heap), struct thread, stride_elem);
+      ready_queue_remove (t);
+      stride_pass = t->pass;
+      return t;
+    }
+  t = list_entry (list_front (&ready_queue[highest_set_bit (ready_bitmap)]),
+                  struct thread, elem);
+  ready_queue_remove (t);
+  if (t->aging_base >= 0)
+    {
+      /* It runs now, so aging has done its job. */
+      t->priority = t->aging_base;
+      t->aging_base = -1;
+    }
+  return t;
+}
+
+/* Priority aging, called every tick.  Each run queue list is
+   FIFO and ready_tick is stamped on entry, so the front thread
+   of a list has waited longest; only the fronts need checking,
+   which bounds the work by the number of priority levels no
+   matter how many threads are ready.  A front thread that has
+   waited thread_aging_ticks moves to the back of the next list
+   up with a fresh ready_tick. */
+static void
+ready_queue_age (void)
+{
+  int64_t now = timer_ticks ();
+  uint64_t bits = ready_bitmap & ~((uint64_t) 1 << PRI_MAX);
+  int top = ready_queue_max_priority ();
+  bool preempt = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (bits != 0)
+    {
+      int pri = highest_set_bit (bits);
+      struct thread *t = list_entry (list_front (&ready_queue[pri]),
+                                     struct thread, elem);
+
+      bits &= ~((uint64_t) 1 << pri);
+      if (now - t->ready_tick < thread_aging_ticks)
+        continue;
+
+      ready_queue_remove (t);
+      if (t->aging_base < 0)
+        t->aging_base = t->priority;
+      t->priority++;
+      ready_queue_push (t);
+      if (t->priority > top)
+        preempt = true;
+    }
+
+  if (preempt && intr_context ())
+    yield_to_max ();
+}
+
+/* Returns the priority of the highest-priority ready thread, or
+   PRI_MIN - 1 if the run queue is empty.  The stride scheduler
+   ignores priorities, so it always reports an empty queue and
+   priority never preempts there.  A ready periodic thread ranks
+   above every priority, as PRI_MAX + 1. */
+static int
+ready_queue_max_priority (void)
+{
+  if (!heap_empty (&rt_heap))
+    return PRI_MAX + 1;
+  return ready_bitmap != 0 ? highest_set_bit (ready_bitmap) : PRI_MIN - 1;
+}
+
+/* Returns true if a ready thread should run before the running
+   one: a periodic thread with an earlier deadline, or any ready
+   thread of higher priority. */
+static bool
+ready_queue_preempts (void)
+{
+  struct thread *cur = running_thread ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cur->rt_period != 0 && cur != idle_thread)
+    return (!heap_empty (&rt_heap)
+            && rt_preempts (heap_entry (heap_min (&rt_heap),
+                                        struct thread, rt_elem)));
+  return cur->priority < ready_queue_max_priority ();
+}
+
+/* Orders stride_heap by pass, breaking ties by tid. */
+static bool
+stride_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, stride_elem);
+  const struct thread *b = heap_entry (b_, struct thread, stride_elem);
+
+  if (a->pass != b->pass)
+    return a->pass < b->pass;
+  return a->tid < b->tid;
+}
+
+/* Orders rt_heap by absolute deadline, breaking ties by tid. */
+static bool
+rt_less (const struct heap_elem *a_, const struct heap_elem *b_,
+         void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, rt_elem);
+  const struct thread *b = heap_entry (b_, struct thread, rt_elem);
+
+  if (a->rt_deadline != b->rt_deadline)
+    return a->rt_deadline < b->rt_deadline;
+  return a->tid < b->tid;
+}
+
+/* Returns true if periodic thread T, just made ready, should
+   preempt the running thread. */
+static bool
+rt_preempts (const struct thread *t)
+{
+  struct thread *cur = running_thread ();
+
+  return (cur == idle_thread || cur->rt_period == 0
+          || rt_less (&t->rt_elem, &cur->rt_elem, NULL));
+}
+
+/* Starts periodic thread T's next period: one period after the
+   current release, or right away if that is already past, with a
+   fresh budget.  Returns true if the release is in the future, so
+   T has to wait for it. */
+static bool
+rt_next_release (struct thread *t)
+{
+  int64_t now = timer_ticks ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->rt_release += t->rt_period;
+  if (t->rt_release < now)
+    t->rt_release = now;
+  t->rt_deadline = t->rt_release + t->rt_rel_deadline;
+  t->rt_used = 0;
+  return t->rt_release > now;
+}
+
+/* Body of a thread made by thread_create_periodic(): runs one
+   job per period, forever. */
+static void
+periodic_thread (void *aux UNUSED)
+{
+  struct thread *cur = thread_current ();
+
+  for (;;)
+    {
+      cur->rt_func (cur->rt_aux);
+      thread_wait_next_period ();
+    }
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -831,6 +1743,7 @@ thread_schedule_tail (struct thread *prev)
 
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
+  sched_trace_record (TRACE_RUN, cur, prev != NULL ? prev->tid : cur->tid);
 
   /* Start new time slice. */
   thread_ticks = 0;
@@ -848,7 +1761,10 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (thread_page_cache_cnt < THREAD_PAGE_CACHE_CNT)
+        thread_page_cache[thread_page_cache_cnt++] = prev;
+      else
+        palloc_free_page (prev);
     }
 }
 
@@ -870,8 +1786,19 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
  
+  sched_trace_record (TRACE_SWITCH, cur, next->tid);
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      uint64_t now = rdtsc ();
+
+      cur->stats.run_cycles += now - cur->run_start_tsc;
+      if (cur->status == THREAD_READY)
+        cur->stats.involuntary_switches++;
+      else
+        cur->stats.voluntary_switches++;
+      next->run_start_tsc = now;
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -880,12 +1807,11 @@ static tid_t
 allocate_tid (void) 
 {
   static tid_t next_tid = 1;
-  tid_t tid;
-
-  lock_acquire (&tid_lock);
-  tid = next_tid++;
-  lock_release (&tid_lock);
+  tid_t tid = 1;
 
+  /* Fetch and increment in one instruction, which no interrupt
+     can split, so no lock is needed. */
+  asm volatile ("lock xaddl %0, %1" : "+r" (tid), "+m" (next_tid) : : "memory");
   return tid;
 }
 
@@ -5,6 +5,8 @@
 #include <list.h>
 #include <stdint.h>
 
+#include "threads/fixed_point.h"
+#include "threads/heap.h"
 #include "threads/synch.h"
 
 
@@ -27,9 +29,40 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
-#define REFRESH_TOTAL_PRIORITY 0       /* HW2 */
-#define BOOL_REFRESH_PRIORITY 1
-#define FIXED_POINT_MASK ( 1 << 14 )
+#define BOOL_REFRESH_PRIORITY 1        /* HW2 */
+
+/* Time slices are set per band of priorities. */
+#define SLICE_BANDS 4                   /* Must divide PRI_MAX - PRI_MIN + 1. */
+
+/* Priority aging. */
+#define AGING_TICKS_DEFAULT 100         /* Ready-queue wait per step. */
+
+/* Stride scheduler tickets. */
+#define STRIDE_TICKETS_DEFAULT 100      /* Tickets of a new thread. */
+#define STRIDE_TICKETS_MAX 1000         /* Most tickets one thread may set. */
+#define STRIDE_ONE (1 << 20)            /* Pass added per tick is
+                                           STRIDE_ONE / tickets. */
+
+/* Real-time (EDF) class admission limit, as the total density
+   budget / deadline of all periodic threads in 1/RT_UTIL_SCALE
+   units.  Kept below 100% so the rest of the system still runs. */
+#define RT_UTIL_SCALE 1000
+#define RT_UTIL_MAX 900
+
+/* Per-thread scheduling statistics, kept in struct thread and
+   copied out by thread_get_stats(). */
+struct thread_stats
+  {
+    uint64_t run_cycles;                /* TSC cycles spent running. */
+    int64_t run_ticks;                  /* Timer ticks spent running. */
+    int64_t ready_ticks;                /* Ticks spent in the run queue. */
+    int64_t sleep_ticks;                /* Ticks spent in timer_sleep(). */
+    int64_t donated_ticks;              /* Ticks run with a donated
+                                           priority or tickets. */
+    unsigned voluntary_switches;        /* Gave up the CPU by blocking. */
+    unsigned involuntary_switches;      /* Preempted or yielded while
+                                           still runnable. */
+  };
 
 /* A kernel thread or user process.
 
@@ -82,11 +115,12 @@ typedef int tid_t;
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   the run queue (thread.c), or it can be an element in the
+   sleeping threads' timing wheel (thread.c).  It can be used
+   these two ways only because they are mutually exclusive: only
+   a thread in the ready state is on the run queue, whereas only
+   a thread in the blocked state is asleep.  Semaphore waiters
+   are queued through `sema_node' instead. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -96,20 +130,60 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     int initial_priority;                 /* Initial priority */ // 초기 priority, 이건 안바뀜
-    //지금 여기에 어떤lock으로부터 얼마의 priority를 받는지에 대한 정보 필요
-    //이 정보는 lock으로부터 priority donation을 받을 시 갱신
-    struct list donation_list; // multiple 여기에 donation_elem
-    struct list_elem donation_elem; // elem로 안쓰고 따로 필요한지는 잘 모르겠으나 allelem로 따로 있으니 일단은 생성
+    int aging_base;                     /* Priority before aging, or -1. */
+    int64_t ready_tick;                 /* Tick it joined the ready queue. */
+    struct heap held_locks;             /* Locks held, highest waiter first. */
+    struct heap_elem donor_elem;        /* Element in a lock's donors heap. */
     struct lock *waiting_for_this_lock;          // nested을 위해서 추후 lock 갱신이 필요할 때를 대비해서
+    struct rwlock *reading;             /* Rwlock held for reading, or NULL. */
+    struct list_elem reader_elem;       /* Element in its readers list. */
+    struct rwlock *draining;            /* Rwlock whose readers it waits
+                                           out as writer, or NULL. */
 
-    int recent_cpu;                 /* fixed point */
+    fixed_t recent_cpu;             /* fixed point */
     int nice;                            /* int */ 
+    int cpu_epoch;                      /* Last second recent_cpu was decayed for. */
+    struct list_elem epoch_elem;        /* List element for thread.c's epoch buckets. */
+
+    int tickets;                        /* Stride tickets, with donation. */
+    int initial_tickets;                /* Stride tickets set by the thread. */
+    int64_t pass;                       /* Stride pass value. */
+    struct heap_elem stride_elem;       /* Element in the stride run queue. */
+
+    /* Real-time (EDF) class, see thread_create_periodic().
+       rt_period is 0 for every other thread. */
+    int64_t rt_period;                  /* Release interval, in ticks. */
+    int64_t rt_budget;                  /* Ticks of CPU per period. */
+    int64_t rt_rel_deadline;            /* Deadline after each release. */
+    int64_t rt_release;                 /* Current period's release tick. */
+    int64_t rt_deadline;                /* Current period's deadline. */
+    int64_t rt_job_deadline;            /* Current job's own deadline. */
+    int64_t rt_used;                    /* Budget used in current period. */
+    bool rt_throttled;                  /* Budget exhausted, stop at once. */
+    bool rt_carried;                    /* Job overran into this period. */
+    unsigned rt_jobs;                   /* # of jobs released. */
+    unsigned rt_misses;                 /* # of jobs that missed deadline. */
+    void (*rt_func) (void *aux);        /* Job body, run once per period. */
+    void *rt_aux;                       /* Auxiliary data for rt_func. */
+    struct heap_elem rt_elem;           /* Element in the EDF run queue. */
 
     int64_t wake_tick;                  /* Wake the thread at this tick */
+    struct wait_node *timed_node;       /* Wait-queue node of a timed wait
+                                           in progress, or NULL. */
+    bool timed_out;                     /* Last timed wait timed out? */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct list_elem tid_elem;          /* List element for thread_find(). */
+
+    /* Accounting, see thread_get_stats(). */
+    struct thread_stats stats;          /* Totals so far. */
+    uint64_t run_start_tsc;             /* TSC when last switched in. */
+    int64_t sleep_tick;                 /* Tick it went to sleep. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct wait_node sema_node;         /* Waiter in a semaphore. */
+    struct wait_node *waiting_node;     /* Waiter in a condition or futex
+                                           queue, or NULL. */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -123,8 +197,8 @@ struct thread
     int exit; // exit(0);
 #endif
 
-    int next_fd;
-    struct file* fd_table[128];
+    struct fd_table *fd_table;          /* Open files, NULL until the first
+                                           open().  See userprog/fdtable.h. */
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -135,17 +209,27 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 extern bool thread_aging;
+extern unsigned thread_aging_ticks;
+extern bool thread_stride;
 
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_set_slice (int band, unsigned ticks);
+unsigned thread_get_slice (int priority);
+bool thread_parse_slices (const char *spec);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_periodic (const char *name, int64_t period,
+                              int64_t budget, int64_t deadline,
+                              thread_func *, void *);
+void thread_wait_next_period (void);
 
 void thread_block (void);
+bool thread_block_timeout (struct wait_node *, int64_t wake_tick);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
@@ -154,13 +238,16 @@ struct thread *thread_current (void);
 tid_t thread_tid (void);
 const char *thread_name (void);
 
+bool thread_get_stats (tid_t, struct thread_stats *);
+struct thread *thread_find (tid_t);
+
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
 
 /* HW1 - Alarm clock */
 void thread_yield_sleep (int64_t wake_tick_value);
-bool wake_time_compare(const struct list_elem *a, const struct list_elem *b, void *aux);
 void wake_blocked_thread(int64_t tick);
+int64_t ticks_until_wake (int64_t limit);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -169,28 +256,22 @@ void thread_foreach (thread_action_func *, void *);
 /* Hw2 - Priority Scheduling */
 void yield_to_max(void);
 bool compare_thread_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
-bool compare_donation_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
 void change_priority(void);
 
+/* Stride scheduling */
+void thread_set_tickets (int);
+int thread_get_tickets (void);
+void thread_refresh_donation (struct thread *);
+
 void set_priority(void);
-int calc_priority(int recent_cpu, int nice);
+int calc_priority(fixed_t recent_cpu, int nice);
 void update_load_avg(void);
-void update_recent_cpu(void);
-
-int convert_to_fixed_point(int n);
-int convert_to_int_to_zero(int x);
-int convert_to_int_to_nearest(int x);
-int add_fixed_and_fixed(int x, int y);
-int add_fixed_and_int(int x, int y);
-int substract_fixed_and_fixed(int x, int y);
-int substract_fixed_and_int(int x, int y);
-int multiply_fixed_and_fixed(int x, int y);
-int multiply_fixed_and_int(int x, int y);
-int divide_fixed_and_fixed(int x, int y);
-int divide_fixed_and_int(int x, int y);
+void thread_mlfqs_catch_up (struct thread *);
+int thread_mlfqs_epoch (void);
+
 int count_ready_threads(void);
-int calc_load_avg();
-int calc_recent_cpu(int recent_cpu, int nice);
+fixed_t calc_load_avg();
+fixed_t calc_recent_cpu(fixed_t recent_cpu, int nice);
 void refresh_all_load_avg_recent_cpu_priority(int bool_refresh);
 void recent_cpu_increase();
 
@@ -203,6 +284,6 @@ void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
-void ready_list_sort(void);
+void thread_update_priority (struct thread *, int priority);
 
 #endif /* threads/thread.h */
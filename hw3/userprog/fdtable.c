@@ -0,0 +1,136 @@
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "userprog/syscall.h"
+
+/* Slots in a newly created table. */
+#define FD_TABLE_INITIAL 32
+
+static bool fd_table_grow (struct fd_table *);
+
+/* Returns the index of the least significant set bit in WORD,
+   which must be nonzero. */
+static inline unsigned
+lowest_set_bit (uint32_t word)
+{
+  uint32_t idx;
+
+  ASSERT (word != 0);
+  asm ("bsfl %1, %0" : "=r" (idx) : "rm" (word));
+  return idx;
+}
+
+/* Gives FILE the lowest free descriptor of the current process
+   and returns it, or -1 if memory for the table runs out. */
+int
+fd_install (struct file *file)
+{
+  struct thread *t = thread_current ();
+  struct fd_table *ft = t->fd_table;
+  size_t word, slot;
+
+  ASSERT (file != NULL);
+
+  if (ft == NULL)
+    {
+      ft = calloc (1, sizeof *ft);
+      if (ft == NULL)
+        return -1;
+      t->fd_table = ft;
+    }
+
+  for (word = ft->free_hint; word < ft->capacity / 32; word++)
+    if (ft->free_map[word] != 0)
+      break;
+  if (word == ft->capacity / 32 && !fd_table_grow (ft))
+    return -1;
+  ft->free_hint = word;
+
+  slot = word * 32 + lowest_set_bit (ft->free_map[word]);
+  ft->free_map[word] &= ~((uint32_t) 1 << (slot % 32));
+  ft->files[slot] = file;
+  return slot + FD_FIRST;
+}
+
+/* Returns the file open as FD in the current process, or a null
+   pointer if FD is not open. */
+struct file *
+fd_lookup (int fd)
+{
+  struct fd_table *ft = thread_current ()->fd_table;
+
+  if (ft == NULL || fd < FD_FIRST || (size_t) (fd - FD_FIRST) >= ft->capacity)
+    return NULL;
+  return ft->files[fd - FD_FIRST];
+}
+
+/* Frees descriptor FD of the current process and returns the
+   file it referred to, which the caller closes, or a null
+   pointer if FD is not open. */
+struct file *
+fd_remove (int fd)
+{
+  struct fd_table *ft = thread_current ()->fd_table;
+  struct file *file = fd_lookup (fd);
+  size_t slot;
+
+  if (file == NULL)
+    return NULL;
+
+  slot = fd - FD_FIRST;
+  ft->files[slot] = NULL;
+  ft->free_map[slot / 32] |= (uint32_t) 1 << (slot % 32);
+  if (slot / 32 < ft->free_hint)
+    ft->free_hint = slot / 32;
+  return file;
+}
+
+/* Closes every file T still has open and frees its table.
+   Called when T's process exits. */
+void
+fd_table_destroy (struct thread *t)
+{
+  struct fd_table *ft = t->fd_table;
+  size_t slot;
+
+  if (ft == NULL)
+    return;
+
+  for (slot = 0; slot < ft->capacity; slot++)
+    if (ft->files[slot] != NULL)
+      close_file (ft->files[slot]);
+  t->fd_table = NULL;
+  free (ft->files);
+  free (ft->free_map);
+  free (ft);
+}
+
+/* Doubles FT's capacity, marking the new slots free.  Returns
+   false, leaving FT unchanged, if memory runs out. */
+static bool
+fd_table_grow (struct fd_table *ft)
+{
+  size_t capacity = ft->capacity != 0 ? ft->capacity * 2 : FD_TABLE_INITIAL;
+  struct file **files;
+  uint32_t *free_map;
+  size_t i;
+
+  files = realloc (ft->files, capacity * sizeof *files);
+  if (files == NULL)
+    return false;
+  ft->files = files;
+
+  free_map = realloc (ft->free_map, capacity / 32 * sizeof *free_map);
+  if (free_map == NULL)
+    return false;
+  ft->free_map = free_map;
+
+  for (i = ft->capacity; i < capacity; i++)
+    files[i] = NULL;
+  for (i = ft->capacity / 32; i < capacity / 32; i++)
+    free_map[i] = UINT32_MAX;
+  ft->capacity = capacity;
+  return true;
+}
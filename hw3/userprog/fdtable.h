@@ -0,0 +1,35 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct file;
+struct thread;
+
+/* First descriptor handed out for files.  0, 1 and 2 are the
+   console. */
+#define FD_FIRST 3
+
+/* A process's open files.
+
+   Descriptor FD is slot FD - FD_FIRST.  The table is allocated on
+   the first open() and doubles whenever it fills up, so there is
+   no fixed limit on open files.  Bit I of free_map is set exactly
+   when slot I is free, and no word of free_map below free_hint
+   has a free bit, so the lowest free descriptor is found with a
+   bit scan rather than by walking the slots. */
+struct fd_table
+  {
+    struct file **files;        /* Open files, NULL in free slots. */
+    uint32_t *free_map;         /* Free-slot bitmap. */
+    size_t capacity;            /* # of slots, a multiple of 32. */
+    size_t free_hint;           /* First free_map word worth scanning. */
+  };
+
+int fd_install (struct file *);
+struct file *fd_lookup (int fd);
+struct file *fd_remove (int fd);
+void fd_table_destroy (struct thread *);
+
+#endif /* userprog/fdtable.h */
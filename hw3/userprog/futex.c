@@ -0,0 +1,157 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <stddef.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Futexes: user-space locks that enter the kernel only to sleep
+   or to wake sleepers.
+
+   A futex is any aligned int in user memory.  Waiters are kept
+   in wait queues hashed by the physical address of that int, so
+   processes that share the page share the futex, and so the
+   queue is found without any per-futex kernel state.  Addresses
+   that hash alike share a queue; futex_wake() skips waiters on
+   other addresses.  Queues are wait_queues, so wakeups go to
+   the highest-priority waiter first. */
+#define FUTEX_HASH_CNT 64               /* Power of 2. */
+static struct wait_queue futex_queues[FUTEX_HASH_CNT];
+
+/* A thread in futex_wait(). */
+struct futex_waiter
+  {
+    struct wait_node node;      /* Element in a futex queue. */
+    uintptr_t key;              /* Physical address waited on. */
+    struct futex_waiter *next;  /* Next one futex_wake() skipped. */
+  };
+
+static uintptr_t futex_key (const int *uaddr, int **kaddr);
+static struct wait_queue *futex_queue (uintptr_t key);
+
+/* Initializes the futex queues. */
+void
+futex_init (void)
+{
+  int i;
+
+  for (i = 0; i < FUTEX_HASH_CNT; i++)
+    wait_queue_init (&futex_queues[i]);
+}
+
+/* If *UADDR equals EXPECTED, sleeps until futex_wake() on UADDR
+   picks this thread or, if TIMEOUT is not negative, until TIMEOUT
+   timer ticks pass.  The check and going to sleep are atomic
+   with respect to futex_wake().  Returns FUTEX_WOKEN,
+   FUTEX_AGAIN, FUTEX_TIMEDOUT, or FUTEX_FAULT if UADDR is not a
+   mapped, aligned user address. */
+int
+futex_wait (int *uaddr, int expected, int64_t timeout)
+{
+  struct thread *cur = thread_current ();
+  struct futex_waiter waiter;
+  struct wait_queue *queue;
+  enum intr_level old_level;
+  bool timed_out = false;
+  int *kaddr;
+
+  waiter.key = futex_key (uaddr, &kaddr);
+  if (waiter.key == 0)
+    return FUTEX_FAULT;
+  queue = futex_queue (waiter.key);
+  waiter.node.queue = NULL;
+
+  old_level = intr_disable ();
+  if (*kaddr != expected)
+    {
+      intr_set_level (old_level);
+      return FUTEX_AGAIN;
+    }
+  if (timeout == 0)
+    {
+      intr_set_level (old_level);
+      return FUTEX_TIMEDOUT;
+    }
+  wait_queue_push (queue, &waiter.node, cur);
+  cur->waiting_node = &waiter.node;
+  if (timeout > 0)
+    timed_out = thread_block_timeout (&waiter.node, timer_ticks () + timeout);
+  else
+    thread_block ();
+  cur->waiting_node = NULL;
+  intr_set_level (old_level);
+
+  return timed_out ? FUTEX_TIMEDOUT : FUTEX_WOKEN;
+}
+
+/* Wakes up to N threads waiting on UADDR, highest priority first,
+   and returns how many were woken, or FUTEX_FAULT if UADDR is not
+   a mapped, aligned user address. */
+int
+futex_wake (int *uaddr, int n)
+{
+  struct futex_waiter *skipped = NULL;
+  struct wait_queue *queue;
+  enum intr_level old_level;
+  uintptr_t key;
+  int *kaddr;
+  int woken = 0;
+
+  key = futex_key (uaddr, &kaddr);
+  if (key == 0)
+    return FUTEX_FAULT;
+  queue = futex_queue (key);
+
+  old_level = intr_disable ();
+  while (woken < n && !wait_queue_empty (queue))
+    {
+      struct wait_node *node = wait_queue_pop (queue);
+      struct futex_waiter *w = wait_node_entry (node, struct futex_waiter,
+                                                node);
+      if (w->key == key)
+        {
+          thread_unblock (node->thread);
+          woken++;
+        }
+      else
+        {
+          /* Same queue, other futex: put it back afterward. */
+          w->next = skipped;
+          skipped = w;
+        }
+    }
+  for (; skipped != NULL; skipped = skipped->next)
+    wait_queue_requeue (queue, &skipped->node);
+  yield_to_max ();
+  intr_set_level (old_level);
+
+  return woken;
+}
+
+/* Returns the physical address of the int at user address UADDR
+   in the current process, and stores its kernel address in
+   *KADDR.  Returns 0 if UADDR is misaligned, not a user address,
+   or not mapped. */
+static uintptr_t
+futex_key (const int *uaddr, int **kaddr)
+{
+  struct thread *cur = thread_current ();
+
+  if ((uintptr_t) uaddr % sizeof *uaddr != 0 || !is_user_vaddr (uaddr)
+      || cur->pagedir == NULL)
+    return 0;
+  *kaddr = pagedir_get_page (cur->pagedir, uaddr);
+  if (*kaddr == NULL)
+    return 0;
+  return vtop (*kaddr);
+}
+
+/* Returns the wait queue for physical address KEY. */
+static struct wait_queue *
+futex_queue (uintptr_t key)
+{
+  return &futex_queues[(key / sizeof (int)) & (FUTEX_HASH_CNT - 1)];
+}
@@ -0,0 +1,16 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+/* Results of futex_wait(). */
+#define FUTEX_WOKEN 0                   /* Woken by futex_wake(). */
+#define FUTEX_AGAIN (-1)                /* *ADDR was not EXPECTED. */
+#define FUTEX_TIMEDOUT (-2)             /* TIMEOUT ran out first. */
+#define FUTEX_FAULT (-3)                /* Bad address. */
+
+void futex_init (void);
+int futex_wait (int *uaddr, int expected, int64_t timeout);
+int futex_wake (int *uaddr, int n);
+
+#endif /* userprog/futex.h */
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/fdtable.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
@@ -43,7 +44,6 @@ process_execute (const char *file_name)
   int temp;
   char *first_word;
   struct thread* t;
-  struct list_elem* e;
   
   
   //printf("testsssssss\n");
@@ -82,21 +82,17 @@ process_execute (const char *file_name)
   
   tid = thread_create (first_word, PRI_DEFAULT, start_process, fn_copy);
 
-  sema_down(&thread_current()->exec_lock);
-
-  if (tid == TID_ERROR)
+  if (tid == TID_ERROR) {
     palloc_free_page (fn_copy); 
+    return TID_ERROR;
+  }
+
+  sema_down(&thread_current()->exec_lock);
   
   
-  e = list_begin(&(thread_current()->child));
-  while (e != list_end(&(thread_current()->child))) {
-    
-    t = list_entry(e, struct thread, child_e);
-    if (t != NULL && t->exit == -1) {
-      return process_wait(tid);
-    }
-    
-    e = list_next(e);
+  t = thread_find(tid); // 자식이 load에 실패했으면 바로 회수
+  if (t != NULL && t->exit == -1) {
+    return process_wait(tid);
   }
 
   
@@ -316,23 +312,17 @@ int
 process_wait (tid_t child_tid) 
 {
   int exit = -1;
-  struct thread* t = NULL;
-  struct list_elem* e = list_begin(&(thread_current()->child));
-  while (e != list_end(&(thread_current()->child))) {
-    
-    t = list_entry(e, struct thread, child_e);
-    if (t != NULL && child_tid == t->tid) {
-      
-      sema_down(&(t->sema_child));
-      exit = t->exit;
-      list_remove(&(t->child_e));
-      sema_up(&(t->sema_mem));
-      return exit;
-    }
-    
-    e = list_next(e);
+  struct thread* t = thread_find(child_tid);
+  /* A child's parent pointer is cleared when the parent exits,
+     see process_exit(), so it never names a reused page. */
+  if (t != NULL && t->parent == thread_current()) {
+    sema_down(&(t->sema_child));
+    exit = t->exit;
+    list_remove(&(t->child_e));
+    t->parent = NULL; // 같은 child를 두 번 wait하지 않도록
+    sema_up(&(t->sema_mem));
   }
-  return -1;
+  return exit;
 }
  
 /* Free the current process's resources. */
@@ -340,8 +330,12 @@ void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  enum intr_level old_level;
   uint32_t *pd;
 
+  /* Close the files the process left open. */
+  fd_table_destroy (cur);
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -359,6 +353,18 @@ process_exit (void)
       pagedir_destroy (pd);
     }
 
+  /* Nobody will wait for our children now.  Let them finish
+     exiting on their own, and make sure none of them keeps a
+     pointer to this thread, whose page is about to be reused. */
+  old_level = intr_disable ();
+  while (!list_empty (&cur->child)) {
+    struct thread *c = list_entry (list_pop_front (&cur->child),
+                                   struct thread, child_e);
+    c->parent = NULL;
+    sema_up (&c->sema_mem);
+  }
+  intr_set_level (old_level);
+
   sema_up(&(cur->sema_child));
   sema_down(&(cur->sema_mem));
 }
@@ -4,12 +4,31 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "userprog/pagedir.h"
 //#include "userprog/syscall.h"
 #include "filesys/off_t.h"
+#include "userprog/fdtable.h"
+#include "userprog/futex.h"
 
 static void syscall_handler (struct intr_frame *);
 void check_vaddr (const void *vaddr);
-struct lock f_lock;
+static void check_user_range (const void *buffer, unsigned size);
+static void check_user_string (const char *str);
+
+/* Serializes the file system's shared bookkeeping (directories,
+   the free map, the open inode list): open, close, create, remove
+   and exec. */
+static struct lock fs_lock;
+
+/* File data locks.  read() holds the lock of the file's inode for
+   reading and write() holds it for writing, so readers of one
+   file, and users of different files, do not wait for each
+   other.  struct inode belongs to filesys/inode.c, so the locks
+   live here and an inode's lock is picked by its address. */
+#define INODE_LOCKS 64                  /* Power of 2. */
+static struct rwlock inode_locks[INODE_LOCKS];
+
+static struct rwlock *inode_lock (struct file *);
 
 
 struct file {
@@ -21,7 +40,13 @@ struct file {
 void
 syscall_init (void) 
 {
-  lock_init(&f_lock);
+  int i;
+
+  lock_init(&fs_lock);
+  lock_set_name(&fs_lock, "fs");
+  for (i = 0; i < INODE_LOCKS; i++)
+    rwlock_init(&inode_locks[i]);
+  futex_init();
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -32,6 +57,38 @@ void check_vaddr (const void *vaddr) {
   }
 }
 
+/* Exits unless all of [BUFFER, BUFFER + SIZE) is mapped user
+   memory.  read() and write() call this before taking the file's
+   inode lock: a page fault in the kernel exits the process, which
+   must not die holding the lock. */
+static void check_user_range (const void *buffer, unsigned size) {
+  uintptr_t page, last;
+  if (size == 0)
+    return;
+  last = (uintptr_t) buffer + size - 1;
+  if (last < (uintptr_t) buffer)
+    exit(-1);
+  check_vaddr((const void *) last);
+  for (page = (uintptr_t) pg_round_down(buffer); page <= last; page += PGSIZE) {
+    if (pagedir_get_page(thread_current()->pagedir, (const void *) page) == NULL)
+      exit(-1);
+  }
+}
+
+/* Exits unless STR is a null-terminated string in mapped user
+   memory.  Called on file names before fs_lock is taken, for the
+   same reason as check_user_range(). */
+static void check_user_string (const char *str) {
+  const char *p = str;
+  do {
+    if (p == str || pg_ofs(p) == 0) {
+      check_vaddr(p);
+      if (pagedir_get_page(thread_current()->pagedir, p) == NULL)
+        exit(-1);
+    }
+  } while (*p++ != '\0');
+}
+
 static void
 syscall_handler (struct intr_frame *f)
 {
@@ -108,6 +165,27 @@ syscall_handler (struct intr_frame *f)
       check_vaddr(f->esp+4);
       close((int)*(uint32_t *)(f->esp+4));
       break; 
+    case SYS_THREAD_STATS:
+      check_vaddr(f->esp+4);
+      check_vaddr(f->esp+8);
+      f->eax = get_thread_stats((int)*(uint32_t *)(f->esp+4), (struct thread_stats *)*(uint32_t *)(f->esp+8));
+      break;
+    case SYS_FUTEX_WAIT:
+      check_vaddr(f->esp+4);
+      check_vaddr(f->esp+8);
+      check_vaddr(f->esp+12);
+      f->eax = futex_wait_sys((int *)*(uint32_t *)(f->esp+4), (int)*(uint32_t *)(f->esp+8), (int)*(uint32_t *)(f->esp+12));
+      break;
+    case SYS_FUTEX_WAKE:
+      check_vaddr(f->esp+4);
+      check_vaddr(f->esp+8);
+      f->eax = futex_wake_sys((int *)*(uint32_t *)(f->esp+4), (int)*(uint32_t *)(f->esp+8));
+      break;
+    case SYS_LOCK_STATS:
+      check_vaddr(f->esp+4);
+      check_vaddr(f->esp+8);
+      f->eax = get_lock_stats((int)*(uint32_t *)(f->esp+4), (struct lock_stats *)*(uint32_t *)(f->esp+8));
+      break;
     default:
       exit(-1);
   }
@@ -121,6 +199,11 @@ void halt (void) {
 
 
 void exit (int status) {
+  /* page_fault() also exits through here, possibly from inside
+     a file system call; the files left open are closed under
+     fs_lock on the way out. */
+  if (lock_held_by_current_thread(&fs_lock))
+    lock_release(&fs_lock);
   printf("%s: exit(%d)\n", thread_name(), status);
   thread_exit();
   //printf("thread_exit() done\n");
@@ -132,18 +215,20 @@ pid_t exec (const char *first_word) {
   if (first_word) {
     return -1;
   }
-  lock_acquire(&f_lock); 
+  check_user_string(first_word);
+  lock_acquire(&fs_lock); 
   result = process_execute(first_word);
-  lock_release(&f_lock);
+  lock_release(&fs_lock);
   return result;
 }
 
  
 int filesize(int fd) {
-   if (thread_current()->fd_table[fd] == NULL) {
+   struct file *f = fd_lookup(fd);
+   if (f == NULL) {
      exit (-1);
    }
-   return file_length(thread_current()->fd_table[fd]);
+   return file_length(f);
 }
 
 
@@ -156,52 +241,47 @@ int read (int fd, void *buffer, unsigned size) {
   int i;
   struct file *f;
   check_vaddr(buffer);
-  lock_acquire(&f_lock);
   if (fd == 0) { 
     for (i = 0; i != size; i++) {
       if (((char *)buffer)[i] == '\0')
         break;
     } 
-    lock_release(&f_lock);
     return i;
   }
   else { 
-    if(!(f = thread_current()->fd_table[fd])) {
-      lock_release(&f_lock);
+    if(!(f = fd_lookup(fd))) {
       exit(-1);
     }
-    if (size = file_read(f, buffer, size)) {
-      lock_release(&f_lock);
-      return size;
-    }
-    lock_release(&f_lock);
-    return 0;
+    check_user_range(buffer, size);
+    rwlock_read_acquire(inode_lock(f));
+    size = file_read(f, buffer, size);
+    rwlock_read_release(inode_lock(f));
+    return size;
   }
 }
 
 
 int write (int fd, const void *buffer, unsigned size) {
-  struct file *f;
-  struct thread *t = thread_current();
-  lock_acquire(&f_lock);
   if (fd == 1) {
-    putbuf(buffer, size);
-    lock_release(&f_lock);
+    check_user_range(buffer, size);
+    putbuf(buffer, size); // console은 자체 lock 사용
     return size;
   }
   else if (fd > 2) {
-    struct file *t_file = t->fd_table[fd];
+    struct file *t_file = fd_lookup(fd);
+    int result;
     if (t_file == NULL) {
-      lock_release(&f_lock);
       exit(-1);
     }
+    check_user_range(buffer, size);
+    rwlock_write_acquire(inode_lock(t_file));
     if (t_file->deny_write) {
       file_deny_write(t_file);
     }
-    lock_release(&f_lock);
-    return file_write(t_file, buffer, size);
+    result = file_write(t_file, buffer, size);
+    rwlock_write_release(inode_lock(t_file));
+    return result;
   }
-  lock_release(&f_lock);
   return -1;
 } 
 
@@ -212,7 +292,12 @@ bool create (const char *file, unsigned size) {
     exit(-1);
     return -1;
   }
-  return filesys_create(file, size);
+  bool success;
+  check_user_string(file);
+  lock_acquire(&fs_lock);
+  success = filesys_create(file, size);
+  lock_release(&fs_lock);
+  return success;
 }
 
 
@@ -220,56 +305,123 @@ int open (const char *file) {
   if (file == NULL) {
     exit(-1);
   }
-  lock_acquire(&f_lock);
+  check_user_string(file);
+  lock_acquire(&fs_lock);
   struct file *f = filesys_open(file);
   if (f == NULL) {
-    lock_release(&f_lock);
+    lock_release(&fs_lock);
     return -1;
   }
-  int i = 3;
-  while(i < 128) {
-    struct file *t_file = thread_current()->fd_table[i];
-   
-    if (t_file == NULL) {
-      if (strcmp(thread_name(), file) == 0) {
-        file_deny_write(f);
-      }
-      thread_current()->fd_table[i] = f;
-      lock_release(&f_lock);
-      return i;
-    }
-    i++;
+  if (strcmp(thread_name(), file) == 0) {
+    file_deny_write(f);
   }
-  lock_release(&f_lock);
-  return -1;
+  int fd = fd_install(f);
+  if (fd == -1) {
+    file_close(f);
+  }
+  lock_release(&fs_lock);
+  return fd;
 }
 
 
 void close(int fd) {
-  struct file *f = thread_current()->fd_table[fd];
+  struct file *f = fd_remove(fd);
   if (f == NULL)
     exit(-1);
+  close_file(f);
+}
+
+
+/* Closes F under fs_lock.  Also used by fd_table_destroy() for
+   the files a process leaves open when it exits. */
+void close_file (struct file *f) {
+  lock_acquire(&fs_lock);
   file_close(f);
-  thread_current()->fd_table[fd] = NULL;
+  lock_release(&fs_lock);
 }
 
 
 void seek(int fd, unsigned offset) {
-  if (thread_current()->fd_table[fd] == NULL)
+  struct file *f = fd_lookup(fd);
+  if (f == NULL)
     exit(-1);
-  file_seek(thread_current()->fd_table[fd], offset);
+  file_seek(f, offset);
 }
 
 
 unsigned tell(int fd) {
-  if (thread_current()->fd_table[fd] == NULL)
+  struct file *f = fd_lookup(fd);
+  if (f == NULL)
     exit(-1);
-  return file_tell(thread_current()->fd_table[fd]);
+  return file_tell(f);
 }
 
 
 bool remove(const char *f) {
   if (f == NULL)
     exit (-1);
-  return filesys_remove(f);
+  bool success;
+  check_user_string(f);
+  lock_acquire(&fs_lock);
+  success = filesys_remove(f);
+  lock_release(&fs_lock);
+  return success;
+}
+
+
+/* Returns the data lock of F's inode. */
+static struct rwlock *inode_lock (struct file *f) {
+  return &inode_locks[((uintptr_t) f->inode >> 4) & (INODE_LOCKS - 1)];
+}
+
+
+/* Copies the scheduling statistics of thread TID, or of the
+   calling thread if TID is -1, to STATS.  Returns 0, or -1 if
+   there is no such thread. */
+int get_thread_stats (int tid, struct thread_stats *stats) {
+  struct thread_stats st;
+  check_vaddr(stats);
+  check_vaddr((const char *)stats + sizeof *stats - 1);
+  if (tid == -1)
+    tid = thread_tid();
+  if (!thread_get_stats(tid, &st))
+    return -1;
+  *stats = st;
+  return 0;
+}
+
+
+/* Copies the statistics of the IDX'th named lock to STATS.
+   Returns 0, or -1 if there is no such lock or the kernel was
+   built without LOCK_PROFILE. */
+int get_lock_stats (int idx, struct lock_stats *stats) {
+  struct lock_stats st;
+  check_vaddr(stats);
+  check_vaddr((const char *)stats + sizeof *stats - 1);
+  if (!lock_get_stats(idx, &st))
+    return -1;
+  *stats = st;
+  return 0;
+}
+
+
+/* Sleeps until another thread wakes ADDR, if *ADDR is still
+   EXPECTED, for at most TIMEOUT ticks unless TIMEOUT is negative.
+   Returns 0 when woken, -1 if *ADDR had changed, -2 on timeout.
+   User space only calls this after finding a lock taken, so an
+   uncontended lock needs no system call. */
+int futex_wait_sys (int *addr, int expected, int timeout) {
+  int result = futex_wait(addr, expected, timeout);
+  if (result == FUTEX_FAULT)
+    exit(-1);
+  return result;
+}
+
+
+/* Wakes up to N threads sleeping on ADDR and returns how many. */
+int futex_wake_sys (int *addr, int n) {
+  int result = futex_wake(addr, n);
+  if (result == FUTEX_FAULT)
+    exit(-1);
+  return result;
 }
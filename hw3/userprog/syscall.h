@@ -3,7 +3,23 @@
 
 #include "lib/user/syscall.h"
 
+#include "threads/thread.h"
+
+struct file;
+
+/* System calls beyond those in lib/syscall-nr.h, numbered well
+   past its last entry. */
+#define SYS_THREAD_STATS 32             /* Get a thread's statistics. */
+#define SYS_FUTEX_WAIT 33               /* Sleep on a user-space lock. */
+#define SYS_FUTEX_WAKE 34               /* Wake sleepers on it. */
+#define SYS_LOCK_STATS 35               /* Get a named lock's statistics. */
+
 void syscall_init (void);
+void close_file (struct file *);
+int get_thread_stats (int tid, struct thread_stats *stats);
+int futex_wait_sys (int *addr, int expected, int timeout);
+int futex_wake_sys (int *addr, int n);
+int get_lock_stats (int idx, struct lock_stats *stats);
 //void exit (int status);
 //int write (int fd, const void *buffer, unsigned size);
 #endif /* userprog/syscall.h */
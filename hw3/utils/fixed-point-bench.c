@@ -0,0 +1,266 @@
+/* Host-side microbenchmark of the MLFQS timer path.
+
+   Replays the fixed-point work that timer_advance() does for the
+   MLFQS, for one running thread and THREADS ready ones, once with
+   the int helpers of the old threads/fixed_point.c and once with
+   the inline ones of threads/fixed_point.h, and prints the cost
+   of each per timer tick:
+
+     BENCH fixed-point impl=<old|new> q=<format> threads=<n> ns-per-tick=<ns>
+
+   followed by "BENCH fixed-point match=<0|1>", which tells whether
+   both computed the same priorities.  With -DFIXED_POINT_Q32_32
+   the new helpers use 32.32 and are not expected to match.
+
+   Build from hw3/ with the kernel's word size and optimization:
+
+     cc -m32 -O -I. -o fixed-point-bench utils/fixed-point-bench.c
+     cc -m32 -O -I. -DFIXED_POINT_Q32_32 -o fixed-point-bench-q32 \
+        utils/fixed-point-bench.c
+
+   Usage: fixed-point-bench [THREADS [SECONDS]] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "threads/fixed_point.h"
+
+/* Must match threads/thread.h and devices/timer.h. */
+#define PRI_MIN 0
+#define PRI_MAX 63
+#define TIMER_FREQ 100
+
+/* The helpers of the old threads/fixed_point.c, in 17.14 over
+   plain ints.  That file was #included into thread.c, so they
+   are kept out of line here as they were there. */
+#define OLD_MASK (1 << 14)
+#define OLD __attribute__ ((noinline))
+
+static OLD int old_convert_to_fixed_point (int n) { return n * OLD_MASK; }
+static OLD int
+old_convert_to_int_to_nearest (int x)
+{
+  if (x >= 0)
+    x = x + OLD_MASK / 2;
+  else
+    x = x - OLD_MASK / 2;
+  return x / OLD_MASK;
+}
+static OLD int old_add_fixed_and_fixed (int x, int y) { return x + y; }
+static OLD int old_add_fixed_and_int (int x, int n) { return x + n * OLD_MASK; }
+static OLD int old_substract_fixed_and_fixed (int x, int y) { return x - y; }
+static OLD int
+old_multiply_fixed_and_fixed (int x, int y)
+{
+  return ((int64_t) x) * y / OLD_MASK;
+}
+static OLD int old_multiply_fixed_and_int (int x, int n) { return x * n; }
+static OLD int
+old_divide_fixed_and_fixed (int x, int y)
+{
+  return ((int64_t) x) * OLD_MASK / y;
+}
+static OLD int old_divide_fixed_and_int (int x, int n) { return x / n; }
+
+/* One simulated thread. */
+struct sim_thread
+  {
+    int nice;
+    int old_recent_cpu;
+    fixed_t recent_cpu;
+    int old_priority;
+    int priority;
+  };
+
+static int
+clamp_priority (int p)
+{
+  return p > PRI_MAX ? PRI_MAX : p < PRI_MIN ? PRI_MIN : p;
+}
+
+/* calc_priority(), calc_load_avg() and calc_recent_cpu() of
+   threads/thread.c, with the old helpers. */
+static int
+old_calc_priority (int recent_cpu, int nice)
+{
+  return clamp_priority (old_convert_to_int_to_nearest (
+    old_substract_fixed_and_fixed (
+      old_substract_fixed_and_fixed (old_convert_to_fixed_point (PRI_MAX),
+                                     old_divide_fixed_and_int (recent_cpu, 4)),
+      old_multiply_fixed_and_int (old_convert_to_fixed_point (nice), 2))));
+}
+
+static int
+old_calc_load_avg (int load_avg, int ready)
+{
+  return old_add_fixed_and_fixed (
+    old_divide_fixed_and_int (old_multiply_fixed_and_int (load_avg, 59), 60),
+    old_divide_fixed_and_int (old_convert_to_fixed_point (ready), 60));
+}
+
+static int
+old_calc_recent_cpu (int load_avg, int recent_cpu, int nice)
+{
+  return old_add_fixed_and_int (
+    old_multiply_fixed_and_fixed (
+      old_divide_fixed_and_fixed (
+        old_multiply_fixed_and_int (load_avg, 2),
+        old_add_fixed_and_int (old_multiply_fixed_and_int (load_avg, 2), 1)),
+      recent_cpu),
+    nice);
+}
+
+/* The same, with the inline helpers. */
+static int
+new_calc_priority (fixed_t recent_cpu, int nice)
+{
+  return clamp_priority (convert_to_int_to_nearest (
+    substract_fixed_and_fixed (
+      substract_fixed_and_fixed (convert_to_fixed_point (PRI_MAX),
+                                 divide_fixed_and_int (recent_cpu, 4)),
+      multiply_fixed_and_int (convert_to_fixed_point (nice), 2))));
+}
+
+static fixed_t
+new_calc_load_avg (fixed_t load_avg, int ready)
+{
+  return add_fixed_and_fixed (
+    divide_fixed_and_int (multiply_fixed_and_int (load_avg, 59), 60),
+    divide_fixed_and_int (convert_to_fixed_point (ready), 60));
+}
+
+static fixed_t
+new_calc_recent_cpu (fixed_t load_avg, fixed_t recent_cpu, int nice)
+{
+  return add_fixed_and_int (
+    multiply_fixed_and_fixed (
+      divide_fixed_and_fixed (
+        multiply_fixed_and_int (load_avg, 2),
+        add_fixed_and_int (multiply_fixed_and_int (load_avg, 2), 1)),
+      recent_cpu),
+    nice);
+}
+
+/* Timer path of timer_advance() with the old helpers: every tick
+   the running thread's recent_cpu goes up by one, every 4 ticks
+   its priority is recomputed, and every second load_avg and all
+   the threads' recent_cpu and priorities are.  Threads take turns
+   running, one second each. */
+static void
+old_run (struct sim_thread *t, int n, long ticks)
+{
+  int load_avg = 0;
+  long tick;
+  int i;
+
+  for (tick = 1; tick <= ticks; tick++)
+    {
+      struct sim_thread *cur = &t[(tick / TIMER_FREQ) % n];
+
+      cur->old_recent_cpu = old_add_fixed_and_int (cur->old_recent_cpu, 1);
+      if (tick % TIMER_FREQ == 0)
+        {
+          load_avg = old_calc_load_avg (load_avg, n);
+          for (i = 0; i < n; i++)
+            {
+              t[i].old_recent_cpu = old_calc_recent_cpu (load_avg,
+                                                         t[i].old_recent_cpu,
+                                                         t[i].nice);
+              t[i].old_priority = old_calc_priority (t[i].old_recent_cpu,
+                                                     t[i].nice);
+            }
+        }
+      if (tick % 4 == 0)
+        cur->old_priority = old_calc_priority (cur->old_recent_cpu, cur->nice);
+    }
+}
+
+/* old_run() with the inline helpers. */
+static void
+new_run (struct sim_thread *t, int n, long ticks)
+{
+  fixed_t load_avg = convert_to_fixed_point (0);
+  long tick;
+  int i;
+
+  for (tick = 1; tick <= ticks; tick++)
+    {
+      struct sim_thread *cur = &t[(tick / TIMER_FREQ) % n];
+
+      cur->recent_cpu = add_fixed_and_int (cur->recent_cpu, 1);
+      if (tick % TIMER_FREQ == 0)
+        {
+          load_avg = new_calc_load_avg (load_avg, n);
+          for (i = 0; i < n; i++)
+            {
+              t[i].recent_cpu = new_calc_recent_cpu (load_avg,
+                                                     t[i].recent_cpu,
+                                                     t[i].nice);
+              t[i].priority = new_calc_priority (t[i].recent_cpu, t[i].nice);
+            }
+        }
+      if (tick % 4 == 0)
+        cur->priority = new_calc_priority (cur->recent_cpu, cur->nice);
+    }
+}
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int n = argc > 1 ? atoi (argv[1]) : 64;
+  long seconds = argc > 2 ? atol (argv[2]) : 100000;
+  long ticks = seconds * TIMER_FREQ;
+  const char *q = FIXED_POINT_SHIFT == 32 ? "32.32" : "17.14";
+  struct sim_thread *t;
+  double start, old_ns, new_ns;
+  int i, match;
+
+  if (n < 1 || seconds < 1)
+    {
+      fprintf (stderr, "usage: %s [THREADS [SECONDS]]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  t = calloc (n, sizeof *t);
+  if (t == NULL)
+    return EXIT_FAILURE;
+  for (i = 0; i < n; i++)
+    {
+      t[i].nice = i % 41 - 20;
+      t[i].recent_cpu = convert_to_fixed_point (0);
+    }
+
+  /* Warm up caches and branch predictors on both. */
+  old_run (t, n, ticks / 10);
+  new_run (t, n, ticks / 10);
+
+  start = now_ns ();
+  old_run (t, n, ticks);
+  old_ns = now_ns () - start;
+
+  start = now_ns ();
+  new_run (t, n, ticks);
+  new_ns = now_ns () - start;
+
+  match = 1;
+  for (i = 0; i < n; i++)
+    if (t[i].old_priority != t[i].priority)
+      match = 0;
+
+  printf ("BENCH fixed-point impl=old q=17.14 threads=%d ns-per-tick=%.1f\n",
+          n, old_ns / ticks);
+  printf ("BENCH fixed-point impl=new q=%s threads=%d ns-per-tick=%.1f\n",
+          q, n, new_ns / ticks);
+  printf ("BENCH fixed-point match=%d\n", match);
+  free (t);
+  return EXIT_SUCCESS;
+}